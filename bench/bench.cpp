@@ -0,0 +1,330 @@
+#include "allocations.h"
+#include "mock_debugger.h"
+#include "session.h"
+#include "variables.h"
+
+#ifdef HOOK_BENCH_RENDER
+#include "view.h"
+#include <imgui.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Hook {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    MockOptions mock;
+    size_t processes = 2;
+    size_t iterations = 20;
+    size_t edits = 8;
+};
+
+double ToMilliseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void Report(const std::string& name, const std::vector<double>& samples, const std::string& note = "") {
+    if (samples.empty()) return;
+    double total = 0;
+    for (double sample : samples) total += sample;
+    double best = *std::min_element(samples.begin(), samples.end());
+    double worst = *std::max_element(samples.begin(), samples.end());
+    std::printf("%-24s %6zu runs  mean %10.3f ms  min %10.3f ms  max %10.3f ms  %s\n",
+                name.c_str(), samples.size(), total / samples.size(), best, worst, note.c_str());
+}
+
+std::vector<double> Measure(size_t iterations, const std::function<void()>& body) {
+    std::vector<double> samples;
+    for (size_t i = 0; i < iterations; ++i) {
+        auto start = Clock::now();
+        body();
+        samples.push_back(ToMilliseconds(Clock::now() - start));
+    }
+    return samples;
+}
+
+std::vector<uint64_t> RefreshCounts() {
+    std::vector<uint64_t> counts;
+    for (auto& session : sessions) {
+        counts.push_back(session->refreshes);
+    }
+    return counts;
+}
+
+void WaitForRefreshes(const std::vector<uint64_t>& before) {
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        while (sessions[i]->refreshes <= before[i]) {
+            if (Clock::now() > deadline) {
+                throw std::runtime_error("Timed out waiting for process " + std::to_string(sessions[i]->pid) + " to refresh");
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+// Index of the variable's parent, for comparing trees from different fetches.
+size_t ParentIndex(const std::vector<VariableInfo>& variables, const VariableInfo& variable) {
+    return variable.parent ? variable.parent - variables.data() : no_parent;
+}
+
+bool SameVariables(const std::vector<VariableInfo>& a, const std::vector<VariableInfo>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].name != b[i].name || a[i].function_name != b[i].function_name || a[i].type_name != b[i].type_name ||
+            a[i].value != b[i].value || a[i].readable != b[i].readable || a[i].placeholder != b[i].placeholder ||
+            a[i].hidden_children != b[i].hidden_children || ParentIndex(a, a[i]) != ParentIndex(b, b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fetches one process's variables straight through FetchAllVariables, first
+// with an empty frame cache and then with a warm one. Returns false if, after
+// the target ran, a warm fetch lists anything a cold one wouldn't.
+bool BenchFetch(MockDebugger& debugger, const BenchOptions& options) {
+    auto process = debugger.Attach(1);
+    auto thread = process->GetSelectedThread();
+    FrameCache cache;
+    std::vector<VariableInfo> variables;
+
+    uint64_t calls = debugger.calls;
+    auto cold = Measure(1, [&] { FetchAllVariables(*thread, nullptr, traversal_limits, cache, variables); });
+    size_t placeholders = std::count_if(variables.begin(), variables.end(), [](const VariableInfo& variable) {
+        return variable.IsPlaceholder();
+    });
+    Report("fetch (cold)", cold, std::to_string(variables.size()) + " variables, " + std::to_string(placeholders) + " placeholders, " +
+           std::to_string(debugger.calls - calls) + " calls");
+
+    calls = debugger.calls;
+    uint64_t allocations = ThreadAllocations();
+    auto warm = Measure(options.iterations, [&] { FetchAllVariables(*thread, nullptr, traversal_limits, cache, variables); });
+    Report("fetch (warm)", warm, std::to_string((debugger.calls - calls) / options.iterations) + " calls, " +
+           std::to_string((ThreadAllocations() - allocations) / options.iterations) + " allocations per fetch");
+
+    std::unordered_map<std::string, const VariableInfo*> index;
+    Report("index", Measure(options.iterations, [&] { index = IndexVariables(variables); }));
+
+    size_t differing = 0;
+    for (size_t i = 0; i < options.iterations; ++i) {
+        process->Continue();
+        process->Stop();
+        FetchAllVariables(*thread, nullptr, traversal_limits, cache, variables);
+        FrameCache cold_cache;
+        std::vector<VariableInfo> cold_variables;
+        FetchAllVariables(*thread, nullptr, traversal_limits, cold_cache, cold_variables);
+        differing += !SameVariables(variables, cold_variables);
+    }
+    std::printf("%-24s %zu of %zu stops differ\n", "warm vs cold fetch", differing, options.iterations);
+    return differing == 0;
+}
+
+// Returns false if an edit did not land or drawing an unchanged tree
+// allocated. Throws if a process could not be attached or stopped refreshing.
+bool BenchSessions(MockDebugger& debugger, const BenchOptions& options) {
+    if (options.processes == 0) {
+        std::printf("%-24s skipped, no processes\n", "sessions");
+        return true;
+    }
+    std::vector<ProcessID> pids;
+    for (size_t i = 0; i < options.processes; ++i) {
+        pids.push_back(100 + i);
+    }
+
+    auto attach = Measure(1, [&] { HandleAttachProcesses(debugger, pids); });
+    Report("attach", attach, std::to_string(sessions.size()) + " processes");
+    if (sessions.size() != pids.size()) {
+        throw std::runtime_error("Could only attach to " + std::to_string(sessions.size()) + " of " + std::to_string(pids.size()) + " processes");
+    }
+
+    Report("sync", Measure(options.iterations, [&] {
+        auto before = RefreshCounts();
+        SyncAllSessions();
+        WaitForRefreshes(before);
+    }));
+
+    std::vector<std::string> names;
+    std::vector<std::string> keys;
+    {
+        std::lock_guard lock(sessions.front()->mutex);
+        for (const auto& variable : sessions.front()->variables) {
+            if (names.size() == options.edits) break;
+            if (variable.type_name == "int" && variable.GetRoot().function_name == "main") {
+                names.push_back(variable.GetFullyQualifiedName());
+                keys.push_back(variable.key);
+            }
+        }
+    }
+    size_t missing_edits = 0;
+    // With nothing to edit, the broadcast would not stop any process and
+    // there would be no refresh to wait for.
+    if (names.empty()) {
+        std::printf("%-24s skipped, no int variables in main to edit\n", "edit broadcast");
+    } else {
+        int next_value = 0;
+        auto broadcast = Measure(options.iterations, [&] {
+            auto before = RefreshCounts();
+            int first_value = next_value + 1;
+            for (const auto& name : names) {
+                PublishAssignment("main", name, std::to_string(++next_value));
+            }
+            BroadcastEdits();
+            WaitForRefreshes(before);
+
+            // The refresh that follows the broadcast already shows every edit.
+            for (auto& session : sessions) {
+                std::lock_guard lock(session->mutex);
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    auto it = session->index.find(keys[i]);
+                    missing_edits += it == session->index.end() || it->second->value != std::to_string(first_value + i);
+                }
+            }
+        });
+        Report("edit broadcast", broadcast, std::to_string(names.size()) + " edits, " + std::to_string(missing_edits) + " missing");
+    }
+
+    size_t diverging = 0;
+    auto scan = Measure(options.iterations, [&] {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        for (auto& session : sessions) {
+            locks.emplace_back(session->mutex);
+        }
+        diverging = 0;
+        for (const auto& variable : sessions.front()->variables) {
+            if (!variable.IsAggregateType() && ValueDiverges(variable.key, variable.value)) {
+                ++diverging;
+            }
+        }
+    });
+    Report("divergence scan", scan, std::to_string(diverging) + " diverging");
+
+    bool allocation_free = true;
+#ifdef HOOK_BENCH_RENDER
+    ImGui::SetAllocatorFunctions(
+        [](size_t size, void*) { CountAllocation(); return std::malloc(size); },
+        [](void* memory, void*) { std::free(memory); });
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1280, 800);
+    io.IniFilename = nullptr;
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    expand_variables = true;
+    auto frame = [&] {
+        io.DeltaTime = 1.0f / 60.0f;
+        ImGui::NewFrame();
+        ImGui::SetNextWindowSize(io.DisplaySize);
+        ImGui::Begin("Hook");
+        DisplaySessions();
+        ImGui::End();
+        ImGui::Render();
+    };
+
+    // The first frames create windows, tree state and draw buffers.
+    uint64_t first_frame_allocations = ThreadAllocations();
+    frame();
+    first_frame_allocations = ThreadAllocations() - first_frame_allocations;
+    for (int i = 0; i < 3; ++i) {
+        frame();
+    }
+
+    // Counted around each frame alone, so the harness's own bookkeeping
+    // doesn't show up, and in total, so a few stray allocations aren't
+    // rounded away.
+    uint64_t frame_allocations = 0;
+    auto render = Measure(options.iterations, [&] {
+        uint64_t before = ThreadAllocations();
+        frame();
+        frame_allocations += ThreadAllocations() - before;
+    });
+    Report("render", render, std::to_string(first_frame_allocations) + " allocations in the first frame, " +
+           std::to_string(frame_allocations) + " in the " + std::to_string(options.iterations) + " after");
+    allocation_free = frame_allocations == 0;
+    ImGui::DestroyContext();
+#else
+    std::printf("%-24s skipped, built without external/imgui: steady frames were not checked for allocations\n", "render");
+#endif
+
+    for (auto& session : sessions) {
+        StopSession(*session);
+    }
+    sessions.clear();
+    return allocation_free && missing_edits == 0;
+}
+
+BenchOptions ParseOptions(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        uint64_t value = std::stoull(argv[i + 1]);
+        if (flag == "--processes") options.processes = value;
+        else if (flag == "--iterations") options.iterations = std::max<uint64_t>(value, 1);
+        else if (flag == "--edits") options.edits = value;
+        else if (flag == "--threads") options.mock.threads = value;
+        else if (flag == "--frames") options.mock.frames = value;
+        else if (flag == "--variables") options.mock.variables_per_frame = value;
+        else if (flag == "--globals") options.mock.globals = value;
+        else if (flag == "--fan-out") options.mock.fan_out = value;
+        else if (flag == "--depth") options.mock.depth = value;
+        else if (flag == "--list-length") options.mock.list_length = value;
+        else if (flag == "--max-depth") traversal_limits.max_depth = value;
+        else if (flag == "--max-children") traversal_limits.max_children = value;
+        else if (flag == "--max-nodes") traversal_limits.max_nodes = value;
+        else if (flag == "--volatile-frames") options.mock.volatile_frames = value;
+        else if (flag == "--call-latency-ns") options.mock.call_latency = std::chrono::nanoseconds(value);
+        else if (flag == "--stop-latency-us") options.mock.stop_latency = std::chrono::microseconds(value);
+        else if (flag == "--seed") options.mock.seed = value;
+        else throw std::runtime_error("Unknown option: " + flag);
+    }
+    return options;
+}
+
+}
+
+}
+
+int main(int argc, char** argv) {
+    using namespace Hook;
+
+    // Exits with 1 for bad arguments, 2 if a benchmark could not run and 3 if
+    // one ran but its results were wrong.
+    BenchOptions options;
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    MockDebugger debugger(options.mock);
+    try {
+        bool passed = BenchFetch(debugger, options);
+        passed = BenchSessions(debugger, options) && passed;
+        return passed ? 0 : 3;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        for (auto& session : sessions) {
+            StopSession(*session);
+        }
+        sessions.clear();
+        return 2;
+    }
+}
@@ -0,0 +1,66 @@
+#include "allocations.h"
+
+#ifdef HOOK_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local uint64_t thread_allocations = 0;
+
+}
+
+void* operator new(std::size_t size) {
+    ++thread_allocations;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace Hook {
+
+uint64_t ThreadAllocations() {
+    return thread_allocations;
+}
+
+void CountAllocation() {
+    ++thread_allocations;
+}
+
+}
+
+#else
+
+namespace Hook {
+
+uint64_t ThreadAllocations() {
+    return 0;
+}
+
+void CountAllocation() {}
+
+}
+
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Hook {
+
+// Heap allocations made so far by the calling thread. Only counted in builds
+// with HOOK_COUNT_ALLOCATIONS, which replaces the global operator new;
+// otherwise always 0.
+uint64_t ThreadAllocations();
+
+// Counts an allocation that bypasses operator new, such as one made through
+// ImGui's allocator.
+void CountAllocation();
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Hook {
+
+using Address = uint64_t;
+using ProcessID = uint64_t;
+
+enum class TypeClass {
+    Other,
+    Builtin,
+    Enumeration,
+};
+
+enum class BasicType {
+    Other,
+    Bool,
+    UnsignedChar,
+    Int,
+    Float,
+    Double,
+    LongDouble,
+    Half,
+};
+
+struct TypeInfo {
+    std::string name;
+    TypeClass type_class = TypeClass::Other;
+    BasicType basic_type = BasicType::Other;
+    bool aggregate = false;
+    std::vector<std::string> enumerators;
+};
+
+// Identifies a stack frame across stops: the same function, at the same
+// canonical frame address, stopped in the same lexical block.
+struct FrameKey {
+    Address function = 0;
+    Address cfa = 0;
+    Address block_start = 0;
+    Address block_end = 0;
+
+    bool operator==(const FrameKey&) const = default;
+};
+
+// A variable or one of its members. A value stays usable across stops for as
+// long as its frame is live; GetValue always reads the current contents.
+class Value {
+public:
+    virtual ~Value() = default;
+
+    virtual std::string GetName() = 0;
+    virtual std::string GetFunctionName() = 0;
+    virtual uint64_t GetID() = 0;
+    // 0 for values that don't live in target memory, such as registers.
+    virtual Address GetAddress() = 0;
+    virtual TypeInfo GetType() = 0;
+    virtual std::optional<std::string> GetValue() = 0;
+    virtual uint32_t GetNumChildren() = 0;
+    virtual std::shared_ptr<Value> GetChildAtIndex(uint32_t index) = 0;
+};
+
+using ValuePtr = std::shared_ptr<Value>;
+
+class Frame {
+public:
+    virtual ~Frame() = default;
+
+    virtual std::string GetFunctionName() = 0;
+    virtual FrameKey GetKey() = 0;
+    // Arguments, locals and statics that are in scope at the frame's pc.
+    virtual std::vector<ValuePtr> GetVariables() = 0;
+    // Writes `value` into the variable at `path` without running target code.
+    virtual bool SetVariable(const std::string& path, const std::string& value) = 0;
+    virtual bool Evaluate(const std::string& expression) = 0;
+};
+
+using FramePtr = std::unique_ptr<Frame>;
+
+class Thread {
+public:
+    virtual ~Thread() = default;
+
+    virtual uint64_t GetID() = 0;
+    virtual std::vector<FramePtr> GetFrames() = 0;
+};
+
+using ThreadPtr = std::unique_ptr<Thread>;
+
+enum class ProcessState {
+    Running,
+    Stopped,
+    Exited,
+};
+
+struct ProcessEvent {
+    ProcessState state = ProcessState::Running;
+    bool restarted = false;
+};
+
+class Process {
+public:
+    virtual ~Process() = default;
+
+    virtual ProcessID GetID() = 0;
+    virtual void Stop() = 0;
+    virtual void Continue() = 0;
+    virtual std::vector<ThreadPtr> GetThreads() = 0;
+    virtual ThreadPtr GetSelectedThread() = 0;
+    virtual std::optional<ProcessEvent> WaitForEvent(std::chrono::milliseconds timeout) = 0;
+    virtual size_t ReadMemory(Address address, void* buffer, size_t size) = 0;
+    virtual size_t WriteMemory(Address address, const void* buffer, size_t size) = 0;
+
+    // Places an auto-continuing breakpoint at `spec` (file:line or function
+    // name), replacing any previous one; an empty spec removes it. `on_hit`
+    // runs on the debugger's own thread while the target is paused, and only
+    // while the sync point is armed. Throws if `spec` cannot be resolved.
+    // Call only while the process is stopped. Replacing or removing the sync
+    // point waits for a callback in progress, and destroying the process
+    // removes it.
+    virtual void SetSyncPoint(const std::string& spec, std::function<void(Thread&)> on_hit) = 0;
+    virtual bool HasSyncPoint() = 0;
+    virtual void ArmSyncPoint(bool armed) = 0;
+};
+
+class Debugger {
+public:
+    virtual ~Debugger() = default;
+
+    // Attaches to `pid` and leaves the process stopped. Throws on failure.
+    virtual std::unique_ptr<Process> Attach(ProcessID pid) = 0;
+};
+
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+// Optional in-process agent. A debuggee built with -DHOOK registers tuning
+// variables with HOOK_VARIABLE; their storage lives in a shared memory segment
+// named after the debuggee's pid, so Hook can read and write them directly
+// without stopping the process. Without -DHOOK the macro declares a plain
+// variable.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace hook::agent {
+
+constexpr uint32_t magic = 0x484f4f4b; // "HOOK"
+constexpr uint32_t layout_version = 2;
+constexpr uint32_t max_variables = 64;
+constexpr size_t max_name_length = 64;
+
+enum class Type : uint32_t {
+    Bool,
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Float,
+    Double,
+};
+
+// Values are at most 8 bytes and 8-byte aligned, so loads and stores from
+// either side are single instructions and never tear.
+struct Variable {
+    char name[max_name_length];
+    Type type;
+    uint32_t size;
+    alignas(8) unsigned char value[8];
+};
+
+struct Segment {
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint32_t> count;
+    uint32_t capacity;
+    // Where the owner mapped the segment, and a random number it picked. A
+    // process that reuses the pid of one that died without unlinking its
+    // segment won't hold the same nonce at that address.
+    uint64_t address;
+    uint64_t nonce;
+    Variable variables[max_variables];
+};
+
+inline std::string SegmentName(pid_t pid) {
+    return "/hook." + std::to_string(pid);
+}
+
+template <typename T>
+constexpr Type TypeOf() {
+    static_assert(std::is_arithmetic_v<T> && sizeof(T) <= 8, "HOOK_VARIABLE only supports arithmetic types");
+    if constexpr (std::is_same_v<T, bool>) return Type::Bool;
+    else if constexpr (std::is_floating_point_v<T>) return sizeof(T) == 4 ? Type::Float : Type::Double;
+    else if constexpr (sizeof(T) == 1) return std::is_signed_v<T> ? Type::Int8 : Type::UInt8;
+    else if constexpr (sizeof(T) == 2) return std::is_signed_v<T> ? Type::Int16 : Type::UInt16;
+    else if constexpr (sizeof(T) == 4) return std::is_signed_v<T> ? Type::Int32 : Type::UInt32;
+    else return std::is_signed_v<T> ? Type::Int64 : Type::UInt64;
+}
+
+// Maps the segment published by process `pid`, or returns nullptr if it has none.
+inline Segment* Open(pid_t pid) {
+    int fd = shm_open(SegmentName(pid).c_str(), O_RDWR, 0);
+    if (fd < 0) return nullptr;
+
+    void* memory = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) return nullptr;
+
+    auto* segment = static_cast<Segment*>(memory);
+    if (segment->magic != magic || segment->version != layout_version) {
+        munmap(memory, sizeof(Segment));
+        return nullptr;
+    }
+    return segment;
+}
+
+inline void Close(Segment* segment) {
+    if (segment) {
+        munmap(segment, sizeof(Segment));
+    }
+}
+
+// The number of registered variables. The segment is written by another
+// process, so its own count and capacity are never trusted past
+// max_variables.
+inline uint32_t Count(const Segment* segment) {
+    if (!segment) return 0;
+    return std::min({segment->count.load(std::memory_order_acquire), segment->capacity, max_variables});
+}
+
+inline Variable* Find(Segment* segment, const char* name) {
+    uint32_t count = Count(segment);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (std::strncmp(segment->variables[i].name, name, max_name_length) == 0) {
+            return &segment->variables[i];
+        }
+    }
+    return nullptr;
+}
+
+inline const Variable* Find(const Segment* segment, const char* name) {
+    return Find(const_cast<Segment*>(segment), name);
+}
+
+inline uint64_t Load(const Variable& variable) {
+    const volatile void* slot = variable.value;
+    switch (variable.size) {
+        case 1: return *static_cast<const volatile uint8_t*>(slot);
+        case 2: return *static_cast<const volatile uint16_t*>(slot);
+        case 4: return *static_cast<const volatile uint32_t*>(slot);
+        default: return *static_cast<const volatile uint64_t*>(slot);
+    }
+}
+
+inline void Store(Variable& variable, uint64_t bits) {
+    volatile void* slot = variable.value;
+    switch (variable.size) {
+        case 1: *static_cast<volatile uint8_t*>(slot) = bits; break;
+        case 2: *static_cast<volatile uint16_t*>(slot) = bits; break;
+        case 4: *static_cast<volatile uint32_t*>(slot) = bits; break;
+        default: *static_cast<volatile uint64_t*>(slot) = bits; break;
+    }
+}
+
+class Agent {
+public:
+    static Agent& Instance() {
+        static Agent agent;
+        return agent;
+    }
+
+    template <typename T>
+    volatile T& Register(const char* name, T initial) {
+        std::lock_guard lock(mutex);
+        if (Variable* existing = Find(segment, name)) {
+            return *reinterpret_cast<volatile T*>(existing->value);
+        }
+        if (!segment || segment->count.load(std::memory_order_relaxed) == segment->capacity) {
+            return *new T(initial);
+        }
+
+        Variable& variable = segment->variables[segment->count.load(std::memory_order_relaxed)];
+        std::strncpy(variable.name, name, max_name_length - 1);
+        variable.type = TypeOf<T>();
+        variable.size = sizeof(T);
+        std::memcpy(variable.value, &initial, sizeof(T));
+        segment->count.fetch_add(1, std::memory_order_release);
+        return *reinterpret_cast<volatile T*>(variable.value);
+    }
+
+private:
+    Agent() : name(SegmentName(getpid())) {
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) return;
+
+        void* memory = MAP_FAILED;
+        if (ftruncate(fd, sizeof(Segment)) == 0) {
+            memory = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (memory == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            return;
+        }
+
+        segment = new (memory) Segment{};
+        segment->capacity = max_variables;
+        segment->address = reinterpret_cast<uint64_t>(memory);
+        std::random_device random;
+        segment->nonce = (uint64_t(random()) << 32) | random();
+        segment->version = layout_version;
+        segment->magic = magic;
+    }
+
+    ~Agent() {
+        if (segment) {
+            shm_unlink(name.c_str());
+        }
+    }
+
+    std::string name;
+    std::mutex mutex;
+    Segment* segment = nullptr;
+};
+
+template <typename T>
+volatile T& Register(const char* name, T initial) {
+    return Agent::Instance().Register<T>(name, initial);
+}
+
+}
+
+#ifdef HOOK
+#define HOOK_VARIABLE(type, name, initial) volatile type& name = ::hook::agent::Register<type>(#name, initial)
+#else
+#define HOOK_VARIABLE(type, name, initial) type name = initial
+#endif
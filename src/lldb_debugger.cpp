@@ -0,0 +1,402 @@
+#include "lldb_debugger.h"
+
+#include <mach-o/dyld.h>
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+namespace Hook {
+
+namespace {
+
+std::string GetExecutablePath() {
+    char path[PATH_MAX];
+    uint32_t size = sizeof(path);
+    if (_NSGetExecutablePath(path, &size) != 0) {
+        throw std::runtime_error("Could not get executable path");
+    }
+
+    return std::string(path);
+}
+
+std::string GetDebugServerPath() {
+    std::string executablePath = GetExecutablePath();
+    size_t appDirPos = executablePath.find(".app");
+    if (appDirPos == std::string::npos) {
+        throw std::runtime_error("Could not get debugserver path");
+    }
+
+    std::string debugServerPath = executablePath.substr(0, appDirPos) + ".app/Contents/Frameworks/bin/debugserver";
+    return debugServerPath;
+}
+
+TypeClass ToTypeClass(lldb::TypeClass type_class) {
+    switch (type_class) {
+        case lldb::eTypeClassBuiltin: return TypeClass::Builtin;
+        case lldb::eTypeClassEnumeration: return TypeClass::Enumeration;
+        default: return TypeClass::Other;
+    }
+}
+
+BasicType ToBasicType(lldb::BasicType basic_type) {
+    switch (basic_type) {
+        case lldb::eBasicTypeBool: return BasicType::Bool;
+        case lldb::eBasicTypeUnsignedChar: return BasicType::UnsignedChar;
+        case lldb::eBasicTypeInt: return BasicType::Int;
+        case lldb::eBasicTypeFloat: return BasicType::Float;
+        case lldb::eBasicTypeDouble: return BasicType::Double;
+        case lldb::eBasicTypeLongDouble: return BasicType::LongDouble;
+        case lldb::eBasicTypeHalf: return BasicType::Half;
+        default: return BasicType::Other;
+    }
+}
+
+class LLDBValue : public Value {
+public:
+    explicit LLDBValue(lldb::SBValue value) : value(value) {
+        if (value.GetType().GetCanonicalType().GetBasicType() == lldb::eBasicTypeUnsignedChar) {
+            this->value.SetFormat(lldb::Format::eFormatDecimal);
+        }
+    }
+
+    std::string GetName() override {
+        const char* name = value.GetName();
+        return name ? name : "";
+    }
+
+    std::string GetFunctionName() override {
+        const char* function_name = value.GetFrame().GetFunctionName();
+        return function_name ? function_name : "";
+    }
+
+    uint64_t GetID() override {
+        return value.GetID();
+    }
+
+    Address GetAddress() override {
+        lldb::addr_t address = value.GetLoadAddress();
+        return address == LLDB_INVALID_ADDRESS ? 0 : address;
+    }
+
+    TypeInfo GetType() override {
+        lldb::SBType type = value.GetType().GetCanonicalType();
+        while (type.GetTypeClass() == lldb::eTypeClassTypedef) {
+            type = type.GetTypedefedType();
+        }
+
+        TypeInfo info;
+        const char* type_name = type.GetName();
+        info.name = type_name ? type_name : "";
+        info.type_class = ToTypeClass(type.GetTypeClass());
+        info.basic_type = ToBasicType(type.GetBasicType());
+        info.aggregate = type.IsAggregateType();
+
+        if (info.type_class == TypeClass::Enumeration) {
+            auto members = type.GetEnumMembers();
+            for (uint32_t i = 0; i < members.GetSize(); ++i) {
+                auto member = members.GetTypeEnumMemberAtIndex(i);
+                const char* member_name = member.IsValid() ? member.GetName() : nullptr;
+                if (member_name && *member_name) {
+                    info.enumerators.push_back(member_name);
+                }
+            }
+        }
+        return info;
+    }
+
+    std::optional<std::string> GetValue() override {
+        const char* current = value.GetValue();
+        if (!current) return std::nullopt;
+        return std::string(current);
+    }
+
+    uint32_t GetNumChildren() override {
+        return value.GetNumChildren();
+    }
+
+    ValuePtr GetChildAtIndex(uint32_t index) override {
+        lldb::SBValue child = value.GetChildAtIndex(index);
+        if (!child.IsValid()) return nullptr;
+        return std::make_shared<LLDBValue>(child);
+    }
+
+private:
+    lldb::SBValue value;
+};
+
+class LLDBFrame : public Frame {
+public:
+    LLDBFrame(lldb::SBFrame frame, lldb::SBTarget target) : frame(frame), target(target) {}
+
+    std::string GetFunctionName() override {
+        const char* function_name = frame.GetFunctionName();
+        return function_name ? function_name : "";
+    }
+
+    FrameKey GetKey() override {
+        FrameKey key;
+        key.cfa = frame.GetCFA();
+
+        lldb::SBFunction function = frame.GetFunction();
+        key.function = function.IsValid() ? function.GetStartAddress().GetLoadAddress(target)
+                                          : frame.GetSymbol().GetStartAddress().GetLoadAddress(target);
+
+        lldb::SBBlock block = frame.GetBlock();
+        if (block.IsValid()) {
+            uint32_t range = block.GetRangeIndexForBlockAddress(frame.GetPCAddress());
+            if (range != std::numeric_limits<uint32_t>::max()) {
+                key.block_start = block.GetRangeStartAddress(range).GetLoadAddress(target);
+                key.block_end = block.GetRangeEndAddress(range).GetLoadAddress(target);
+            }
+        } else {
+            key.block_start = key.block_end = frame.GetPC();
+        }
+        return key;
+    }
+
+    std::vector<ValuePtr> GetVariables() override {
+        std::vector<ValuePtr> variables;
+
+        lldb::SBValueList frameVariables = frame.GetVariables(true, true, true, true); // arguments, locals, statics, in_scope_only
+        for (uint32_t i = 0; i < frameVariables.GetSize(); i++) {
+            lldb::SBValue var = frameVariables.GetValueAtIndex(i);
+            if (var) {
+                variables.push_back(std::make_shared<LLDBValue>(var));
+            }
+        }
+        return variables;
+    }
+
+    bool SetVariable(const std::string& path, const std::string& value) override {
+        lldb::SBValue var = frame.GetValueForVariablePath(path.c_str());
+        lldb::SBError error;
+        return var && var.SetValueFromCString(value.c_str(), error) && error.Success();
+    }
+
+    bool Evaluate(const std::string& expression) override {
+        lldb::SBValue value = frame.EvaluateExpression(expression.c_str());
+        return value && value.GetValue();
+    }
+
+private:
+    lldb::SBFrame frame;
+    lldb::SBTarget target;
+};
+
+class LLDBThread : public Thread {
+public:
+    LLDBThread(lldb::SBThread thread, lldb::SBTarget target) : thread(thread), target(target) {}
+
+    uint64_t GetID() override {
+        return thread.GetThreadID();
+    }
+
+    std::vector<FramePtr> GetFrames() override {
+        std::vector<FramePtr> frames;
+        const auto num_frames = thread.GetNumFrames();
+        frames.reserve(num_frames);
+
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            lldb::SBFrame frame = thread.GetFrameAtIndex(i);
+            if (frame) {
+                frames.push_back(std::make_unique<LLDBFrame>(frame, target));
+            }
+        }
+        return frames;
+    }
+
+private:
+    lldb::SBThread thread;
+    lldb::SBTarget target;
+};
+
+class LLDBProcess : public Process {
+public:
+    LLDBProcess(lldb::SBDebugger& debugger, ProcessID pid) {
+        listener = lldb::SBListener(("hook.session." + std::to_string(pid)).c_str());
+
+        lldb::SBAttachInfo attachInfo;
+        attachInfo.SetProcessID(pid);
+        attachInfo.SetListener(listener);
+
+        lldb::SBError error;
+        target = debugger.CreateTarget("");
+        process = target.Attach(attachInfo, error);
+        if (!process.IsValid() || error.Fail()) {
+            throw std::runtime_error(std::string("Failed to attach to process: ") + error.GetCString());
+        }
+
+        auto event_mask = lldb::SBProcess::eBroadcastBitStateChanged;
+        auto event_bits = process.GetBroadcaster().AddListener(listener, event_mask);
+        if (event_bits != event_mask) {
+            throw std::runtime_error("Could not set up event listener");
+        }
+    }
+
+    // The breakpoint's baton is this object, so it must not outlive it.
+    ~LLDBProcess() override {
+        SetSyncPoint("", nullptr);
+    }
+
+    ProcessID GetID() override {
+        return process.GetProcessID();
+    }
+
+    void Stop() override {
+        process.Stop();
+    }
+
+    void Continue() override {
+        process.Continue();
+    }
+
+    std::vector<ThreadPtr> GetThreads() override {
+        std::vector<ThreadPtr> threads;
+        for (uint32_t i = 0; i < process.GetNumThreads(); ++i) {
+            threads.push_back(std::make_unique<LLDBThread>(process.GetThreadAtIndex(i), target));
+        }
+        return threads;
+    }
+
+    ThreadPtr GetSelectedThread() override {
+        lldb::SBThread thread = process.GetSelectedThread();
+        if (!thread) {
+            std::cerr << "Failed to get thread" << std::endl;
+            return nullptr;
+        }
+        return std::make_unique<LLDBThread>(thread, target);
+    }
+
+    std::optional<ProcessEvent> WaitForEvent(std::chrono::milliseconds timeout) override {
+        lldb::SBEvent event;
+        uint32_t seconds = std::max<uint32_t>(1, std::ceil(timeout.count() / 1000.0));
+        if (!listener.WaitForEvent(seconds, event)) return std::nullopt;
+        if (!lldb::SBProcess::EventIsProcessEvent(event)) return std::nullopt;
+
+        ProcessEvent result;
+        switch (lldb::SBProcess::GetStateFromEvent(event)) {
+            case lldb::eStateStopped:
+                result.state = ProcessState::Stopped;
+                break;
+            case lldb::eStateExited:
+            case lldb::eStateDetached:
+            case lldb::eStateCrashed:
+                result.state = ProcessState::Exited;
+                break;
+            default:
+                result.state = ProcessState::Running;
+                break;
+        }
+        result.restarted = lldb::SBProcess::GetRestartedFromEvent(event);
+        return result;
+    }
+
+    size_t ReadMemory(Address address, void* buffer, size_t size) override {
+        lldb::SBError error;
+        return process.ReadMemory(address, buffer, size, error);
+    }
+
+    size_t WriteMemory(Address address, const void* buffer, size_t size) override {
+        lldb::SBError error;
+        return process.WriteMemory(address, buffer, size, error);
+    }
+
+    void SetSyncPoint(const std::string& spec, std::function<void(Thread&)> on_hit) override {
+        {
+            std::lock_guard lock(sync_mutex);
+            if (sync_breakpoint.IsValid()) {
+                target.BreakpointDelete(sync_breakpoint.GetID());
+                sync_breakpoint = lldb::SBBreakpoint();
+            }
+        }
+        {
+            // Waits for a hit that is still running the old callback.
+            std::lock_guard lock(callback_mutex);
+            sync_callback = spec.empty() ? nullptr : std::move(on_hit);
+        }
+        if (spec.empty()) return;
+
+        lldb::SBBreakpoint breakpoint;
+        auto colon = spec.rfind(':');
+        bool has_line = colon != std::string::npos && colon + 1 < spec.size() &&
+                        std::all_of(spec.begin() + colon + 1, spec.end(), [](char c) { return std::isdigit(c); });
+        if (has_line) {
+            breakpoint = target.BreakpointCreateByLocation(spec.substr(0, colon).c_str(), std::stoul(spec.substr(colon + 1)));
+        } else {
+            breakpoint = target.BreakpointCreateByName(spec.c_str());
+        }
+
+        if (!breakpoint.IsValid() || breakpoint.GetNumLocations() == 0) {
+            if (breakpoint.IsValid()) {
+                target.BreakpointDelete(breakpoint.GetID());
+            }
+            throw std::runtime_error("Could not resolve sync point " + spec);
+        }
+
+        // The process is stopped, so the breakpoint can't be hit before it is
+        // disabled and has its callback.
+        breakpoint.SetEnabled(false);
+        breakpoint.SetCallback(SyncPointCallback, this);
+        std::lock_guard lock(sync_mutex);
+        sync_breakpoint = breakpoint;
+    }
+
+    bool HasSyncPoint() override {
+        std::lock_guard lock(sync_mutex);
+        return sync_breakpoint.IsValid();
+    }
+
+    void ArmSyncPoint(bool armed) override {
+        std::lock_guard lock(sync_mutex);
+        if (sync_breakpoint.IsValid()) {
+            sync_breakpoint.SetEnabled(armed);
+        }
+    }
+
+private:
+    static bool SyncPointCallback(void* baton, lldb::SBProcess& process, lldb::SBThread& thread, lldb::SBBreakpointLocation& location) {
+        auto& self = *static_cast<LLDBProcess*>(baton);
+        std::lock_guard lock(self.callback_mutex);
+        if (self.sync_callback) {
+            LLDBThread hit(thread, self.target);
+            self.sync_callback(hit);
+        }
+        return false;
+    }
+
+    lldb::SBTarget target;
+    lldb::SBProcess process;
+    lldb::SBListener listener;
+    // The breakpoint is armed from the UI thread and from inside its own
+    // callback, which runs on LLDB's private state thread, so both it and the
+    // callback are only touched under their locks. The callback runs with
+    // `callback_mutex` held and may take `sync_mutex`, never the reverse.
+    std::mutex sync_mutex;
+    lldb::SBBreakpoint sync_breakpoint;
+    std::mutex callback_mutex;
+    std::function<void(Thread&)> sync_callback;
+};
+
+}
+
+LLDBDebugger::LLDBDebugger() {
+    setenv("LLDB_DEBUGSERVER_PATH", GetDebugServerPath().c_str(), 1);
+    lldb::SBDebugger::Initialize();
+    debugger = lldb::SBDebugger::Create();
+}
+
+LLDBDebugger::~LLDBDebugger() {
+    lldb::SBDebugger::Destroy(debugger);
+}
+
+std::unique_ptr<Process> LLDBDebugger::Attach(ProcessID pid) {
+    return std::make_unique<LLDBProcess>(debugger, pid);
+}
+
+}
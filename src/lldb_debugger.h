@@ -0,0 +1,20 @@
+#pragma once
+
+#include "debugger.h"
+
+#include <lldb/API/LLDB.h>
+
+namespace Hook {
+
+class LLDBDebugger : public Debugger {
+public:
+    LLDBDebugger();
+    ~LLDBDebugger() override;
+
+    std::unique_ptr<Process> Attach(ProcessID pid) override;
+
+private:
+    lldb::SBDebugger debugger;
+};
+
+}
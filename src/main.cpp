@@ -1,344 +1,527 @@
+#include "allocations.h"
 #include "backend.h"
-
-#include <mach-o/dyld.h>
+#include "hook_agent.h"
+#include "lldb_debugger.h"
+#include "mock_debugger.h"
+#include "session.h"
+#include "view.h"
 
 #include <imgui.h>
 #include <imgui_stdlib.h>
 
-#include <lldb/API/LLDB.h>
-
 #include <iostream>
 #include <vector>
 #include <string>
 #include <sstream>
 #include <limits>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <optional>
 
 
 namespace Hook {
 
-std::string GetExecutablePath() {
-    char path[PATH_MAX];
-    uint32_t size = sizeof(path);
-    if (_NSGetExecutablePath(path, &size) != 0) {
-        throw std::runtime_error("Could not get executable path");
+bool open_pid_popup = true;
+bool open_sync_point_popup = false;
+
+std::unique_ptr<Debugger> debugger;
+// Heap allocations made drawing the variable tree in the last frame.
+uint64_t view_allocations = 0;
+
+std::vector<ProcessID> ParsePids(const std::string& input) {
+    std::vector<ProcessID> pids;
+    std::string normalized = input;
+    std::replace(normalized.begin(), normalized.end(), ',', ' ');
+    std::istringstream stream(normalized);
+    std::string token;
+    while (stream >> token) {
+        pids.push_back(std::stoull(token));
     }
-
-    return std::string(path);
+    return pids;
 }
 
-std::string GetDebugServerPath() {
-    std::string executablePath = GetExecutablePath();
-    size_t appDirPos = executablePath.find(".app");
-    if (appDirPos == std::string::npos) {
-        throw std::runtime_error("Could not get debugserver path");
+struct VariableRef {
+    bool agent = false;
+    bool integral = false;
+    std::string function_name;
+    std::string name;
+
+    std::string GetKey() const {
+        return function_name + "|" + name;
+    }
+
+    std::string GetLabel() const {
+        if (agent) return "[agent] " + name;
+        return function_name.empty() ? name : "(" + function_name + ") " + name;
     }
+};
 
-    std::string debugServerPath = executablePath.substr(0, appDirPos) + ".app/Contents/Frameworks/bin/debugserver";
-    return debugServerPath;
+double AgentBitsToDouble(hook::agent::Type type, uint64_t bits) {
+    auto as = [bits]<typename T>(T) {
+        T value;
+        std::memcpy(&value, &bits, sizeof(T));
+        return static_cast<double>(value);
+    };
+    switch (type) {
+        case hook::agent::Type::Bool: return bits != 0;
+        case hook::agent::Type::Int8: return as(int8_t{});
+        case hook::agent::Type::UInt8: return as(uint8_t{});
+        case hook::agent::Type::Int16: return as(int16_t{});
+        case hook::agent::Type::UInt16: return as(uint16_t{});
+        case hook::agent::Type::Int32: return as(int32_t{});
+        case hook::agent::Type::UInt32: return as(uint32_t{});
+        case hook::agent::Type::Int64: return as(int64_t{});
+        case hook::agent::Type::UInt64: return as(uint64_t{});
+        case hook::agent::Type::Float: return as(float{});
+        case hook::agent::Type::Double: return as(double{});
+    }
+    return 0.0;
 }
 
-struct VariableInfo {
-    VariableInfo(lldb::SBValue& value) {
-        this->name = value.GetName();
-        this->function_name = (name.substr(0,2) == "::") ? "" : value.GetFrame().GetFunctionName();
-        this->id = value.GetID();
+uint64_t AgentBitsFromDouble(hook::agent::Type type, double value) {
+    uint64_t bits = 0;
+    auto to = [&bits]<typename T>(T converted) {
+        std::memcpy(&bits, &converted, sizeof(T));
+        return bits;
+    };
+    switch (type) {
+        case hook::agent::Type::Bool: return value != 0.0;
+        case hook::agent::Type::Int8: return to(static_cast<int8_t>(std::llround(value)));
+        case hook::agent::Type::UInt8: return to(static_cast<uint8_t>(std::llround(value)));
+        case hook::agent::Type::Int16: return to(static_cast<int16_t>(std::llround(value)));
+        case hook::agent::Type::UInt16: return to(static_cast<uint16_t>(std::llround(value)));
+        case hook::agent::Type::Int32: return to(static_cast<int32_t>(std::llround(value)));
+        case hook::agent::Type::UInt32: return to(static_cast<uint32_t>(std::llround(value)));
+        case hook::agent::Type::Int64: return to(static_cast<int64_t>(std::llround(value)));
+        case hook::agent::Type::UInt64: return to(static_cast<uint64_t>(std::llround(value)));
+        case hook::agent::Type::Float: return to(static_cast<float>(value));
+        case hook::agent::Type::Double: return to(value);
+    }
+    return bits;
+}
 
-        this->type = value.GetType().GetCanonicalType();
-        while (type.GetTypeClass() == lldb::eTypeClassTypedef) {
-            this->type.GetTypedefedType();
-        }
-        this->type_name = this->type.GetName();
-        this->type_class = this->type.GetTypeClass();
-        this->basic_type = this->type.GetBasicType();
-        if (this->basic_type == lldb::eBasicTypeUnsignedChar) {
-            value.SetFormat(lldb::Format::eFormatDecimal);
-        }
+// When a value read from the target was current: from when the target
+// stopped until it resumed, or just now for agent variables.
+struct ReadTime {
+    std::chrono::steady_clock::time_point stopped_at;
+    std::chrono::steady_clock::time_point resumed_at;
+};
 
-        this->is_nested = this->type.IsAggregateType();
-        if (!this->is_nested) {
-            this->value = value.GetValue();
+std::optional<double> ReadVariable(Session& session, const VariableRef& ref, ReadTime* read_at = nullptr) {
+    if (ref.agent) {
+        auto* variable = hook::agent::Find(session.agent, ref.name.c_str());
+        if (!variable) return std::nullopt;
+        if (read_at) {
+            read_at->stopped_at = read_at->resumed_at = std::chrono::steady_clock::now();
         }
+        return AgentBitsToDouble(variable->type, hook::agent::Load(*variable));
     }
 
-    VariableInfo() = default;
-
-    bool IsAggregateType() const {
-        return is_nested;
+    std::lock_guard lock(session.mutex);
+    auto it = session.index.find(ref.GetKey());
+    if (it == session.index.end()) return std::nullopt;
+    if (read_at) *read_at = {session.stopped_at, session.resumed_at};
+    try {
+        return std::stod(it->second->value);
+    } catch (const std::exception&) {
+        return std::nullopt;
     }
+}
 
-    std::string GetFullyQualifiedValue() const {
-        if (type_class == lldb::eTypeClassEnumeration) {
-            return type_name + "::" + value;
-        } else {
-            return value;
+void PublishValue(const VariableRef& ref, double value) {
+    if (ref.agent) {
+        for (auto& session : sessions) {
+            if (auto* variable = hook::agent::Find(session->agent, ref.name.c_str())) {
+                PublishAgentChange(*variable, AgentBitsFromDouble(variable->type, value));
+                return;
+            }
         }
+        return;
+    }
+
+    std::ostringstream formatted;
+    if (ref.integral) {
+        formatted << std::llround(value);
+    } else {
+        formatted.precision(std::numeric_limits<double>::max_digits10);
+        formatted << value;
     }
+    PublishAssignment(ref.function_name, ref.name, formatted.str());
+}
 
-    const VariableInfo& GetRoot() const {
-        const VariableInfo* root = this;
-        while (root->parent) {
-            root = root->parent;
+std::vector<VariableRef> GetSweepableVariables() {
+    std::vector<VariableRef> refs;
+    if (sessions.empty()) return refs;
+
+    Session& session = *sessions.front();
+    if (const hook::agent::Segment* agent = session.agent) {
+        uint32_t count = hook::agent::Count(agent);
+        for (uint32_t i = 0; i < count; ++i) {
+            const auto& variable = agent->variables[i];
+            bool integral = variable.type != hook::agent::Type::Float && variable.type != hook::agent::Type::Double;
+            refs.push_back({true, integral, "", variable.name});
         }
-        return *root;
     }
 
-    bool IsRoot() const {
-        return !parent;
+    std::lock_guard lock(session.mutex);
+    for (const auto& var : session.variables) {
+        if (var.IsAggregateType() || var.type_class != TypeClass::Builtin || var.basic_type == BasicType::Bool) continue;
+
+        bool integral = var.basic_type != BasicType::Float && var.basic_type != BasicType::Double &&
+                        var.basic_type != BasicType::LongDouble && var.basic_type != BasicType::Half;
+        refs.push_back({false, integral, var.GetRoot().function_name, var.GetFullyQualifiedName()});
     }
+    return refs;
+}
 
-    bool ParentIsContainer() const {
-        return name.back() == ']';
+// Applies each candidate value to every process in turn, lets the target run
+// for the dwell time and samples the objective before and after. Counters are
+// summed across processes and reported per second; gauges are averaged.
+struct Sweep {
+    enum class Phase { Idle, Applying, Dwelling, Sampling };
+    using Clock = std::chrono::steady_clock;
+    struct CounterSample {
+        double value;
+        ReadTime read_at;
+    };
+
+    VariableRef input;
+    VariableRef objective;
+    std::vector<double> values;
+    std::chrono::milliseconds dwell{1000};
+    bool counter = true;
+    bool maximize = true;
+    int steps = 0;
+    int refine_passes = 0;
+
+    Phase phase = Phase::Idle;
+    size_t next = 0;
+    double current = 0.0;
+    std::unordered_map<ProcessID, CounterSample> counter_start;
+    double gauge_total = 0.0;
+    size_t gauge_samples = 0;
+    Clock::time_point started;
+    std::unordered_map<ProcessID, uint64_t> refresh_marks;
+    std::vector<std::pair<double, double>> results;
+} sweep;
+
+bool sweep_window = false;
+
+void RequestRefresh() {
+    sweep.refresh_marks.clear();
+    for (auto& session : sessions) {
+        sweep.refresh_marks[session->pid] = session->refreshes;
     }
+}
 
-    std::string GetFullyQualifiedName() const {
-        std::string full_name;
-        const VariableInfo* current = this;
-        while (current != nullptr) {
-            full_name = current->name + full_name;
-            if (!current->IsRoot() && !current->ParentIsContainer()) {
-                full_name = "." + full_name;
-            }
-            current = current->parent;
+bool RefreshDone() {
+    for (auto& session : sessions) {
+        auto it = sweep.refresh_marks.find(session->pid);
+        if (it != sweep.refresh_marks.end() && session->refreshes == it->second) {
+            return false;
         }
-        return full_name;
     }
+    return true;
+}
 
-    std::string name;
-    std::string function_name;
-    std::string value;
-    lldb::SBType type;
-    std::string type_name;
-    lldb::TypeClass type_class;
-    lldb::BasicType basic_type;
-    bool is_nested = false;
-    uint64_t id = std::numeric_limits<uint64_t>::max();
-    std::vector<VariableInfo*> children;
-    VariableInfo* parent = nullptr;
-};
-
-std::vector<VariableInfo> variables;
-const VariableInfo* current_var_info;
-bool published_changes = true;
-bool open_pid_popup = true;
-
-lldb::SBDebugger debugger;
-lldb::SBTarget target;
-lldb::SBListener listener;
-lldb::SBError error;
-lldb::SBProcess process;
-
-lldb::pid_t pid = 0;
-
-void HelpMarker(const char* desc) {
-    ImGui::TextDisabled("(?)");
-    if (ImGui::BeginItemTooltip()) {
-        ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
-        ImGui::TextUnformatted(desc);
-        ImGui::PopTextWrapPos();
-        ImGui::EndTooltip();
+std::optional<double> SampleGauge() {
+    double total = 0.0;
+    size_t found = 0;
+    for (auto& session : sessions) {
+        if (auto value = ReadVariable(*session, sweep.objective)) {
+            total += *value;
+            ++found;
+        }
     }
+    if (!found) return std::nullopt;
+    return total / found;
 }
 
-void PublishChange(const VariableInfo& varInfo) {
-    current_var_info = &varInfo;
-    published_changes = false;
-    process.Stop();
+std::unordered_map<ProcessID, Sweep::CounterSample> SampleCounters() {
+    std::unordered_map<ProcessID, Sweep::CounterSample> samples;
+    for (auto& session : sessions) {
+        ReadTime read_at;
+        if (auto value = ReadVariable(*session, sweep.objective, &read_at)) {
+            samples[session->pid] = {*value, read_at};
+        }
+    }
+    return samples;
 }
 
-lldb::SBValue FindVariableById(lldb::SBFrame& frame, uint64_t id) {
-    lldb::SBValueList vars = frame.GetVariables(true, true, true, true);
-    for (int i = 0; i < vars.GetSize(); ++i) {
-        lldb::SBValue v = vars.GetValueAtIndex(i);
-        if (v.GetID() == id) {
-            return v;
+// Each process's counter is divided by the time it actually ran between the
+// two samples, from resuming after the first to stopping for the second,
+// rather than by when the UI got to see them, so stop, fetch and frame
+// latency don't count towards the rate.
+double CounterRate(const std::unordered_map<ProcessID, Sweep::CounterSample>& end) {
+    double rate = 0.0;
+    for (const auto& [pid, sample] : end) {
+        auto start = sweep.counter_start.find(pid);
+        if (start == sweep.counter_start.end()) continue;
+        double seconds = std::chrono::duration<double>(sample.read_at.stopped_at - start->second.read_at.resumed_at).count();
+        if (seconds > 0.0) {
+            rate += (sample.value - start->second.value) / seconds;
         }
     }
-    return lldb::SBValue();
+    return rate;
 }
 
-std::vector<lldb::SBValue> GetVariablesFromFrame(lldb::SBFrame& frame) {
-    std::vector<lldb::SBValue> variables;
+// Integral inputs get whole, distinct values, so no point is swept twice.
+std::vector<double> LinearValues(double from, double to, int steps, bool integral) {
+    std::vector<double> values;
+    steps = std::max(steps, 2);
+    for (int i = 0; i < steps; ++i) {
+        double value = from + (to - from) * i / (steps - 1);
+        values.push_back(integral ? std::round(value) : value);
+    }
+    if (integral) {
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+    }
+    return values;
+}
 
-    lldb::SBValueList frameVariables = frame.GetVariables(true, true, true, true); // arguments, locals, statics, in_scope_only
-    for (int i = 0; i < frameVariables.GetSize(); i++) {
-        lldb::SBValue var = frameVariables.GetValueAtIndex(i);
-        if (var) {
-            variables.push_back(var);
+const std::pair<double, double>* BestSweepResult() {
+    const std::pair<double, double>* best = nullptr;
+    for (const auto& result : sweep.results) {
+        if (!best || (sweep.maximize ? result.second > best->second : result.second < best->second)) {
+            best = &result;
         }
     }
-    return variables;
+    return best;
 }
 
-lldb::SBThread GetThread(lldb::SBProcess& process) {
-    lldb::SBThread thread = process.GetSelectedThread();
-    if (!thread) {
-        std::cerr << "Failed to get thread" << std::endl;
+void BeginSweepValue() {
+    sweep.current = sweep.values[sweep.next++];
+    PublishValue(sweep.input, sweep.current);
+    if (!sweep.input.agent) {
+        RequestRefresh();
+    } else if (!sweep.objective.agent) {
+        RequestRefresh();
+        SyncAllSessions();
+    } else {
+        sweep.refresh_marks.clear();
     }
-    return thread;
+    sweep.phase = Sweep::Phase::Applying;
 }
 
-std::vector<lldb::SBFrame> GetFrames(lldb::SBThread& thread) {
-    std::vector<lldb::SBFrame> frames;
-    const auto num_frames = thread.GetNumFrames();
-    frames.reserve(num_frames);
+void FinishSweepValue() {
+    double result = 0.0;
+    if (sweep.counter) {
+        result = CounterRate(SampleCounters());
+    } else if (sweep.objective.agent && sweep.gauge_samples) {
+        result = sweep.gauge_total / sweep.gauge_samples;
+    } else {
+        result = SampleGauge().value_or(0.0);
+    }
+    sweep.results.emplace_back(sweep.current, result);
+
+    if (sweep.next < sweep.values.size()) {
+        BeginSweepValue();
+        return;
+    }
 
-    for (auto i = 0; i < num_frames; ++i) {
-        lldb::SBFrame frame = thread.GetFrameAtIndex(i);
-        if (frame) {
-            frames.push_back(frame);
+    if (sweep.refine_passes > 0 && sweep.values.size() > 1) {
+        --sweep.refine_passes;
+        double step = std::abs(sweep.values[1] - sweep.values[0]);
+        // Integral neighbours one apart have all been tried already.
+        if (!sweep.input.integral || step > 1.0) {
+            double best = BestSweepResult()->first;
+            sweep.values = LinearValues(best - step, best + step, sweep.steps, sweep.input.integral);
+            sweep.next = 0;
+            BeginSweepValue();
+            return;
         }
     }
-    return frames;
+
+    sweep.phase = Sweep::Phase::Idle;
 }
 
-void DisplayVariable(VariableInfo& varInfo) {
-    std::string prefix = !varInfo.IsRoot() ? "" : varInfo.function_name.empty() ? "" : "(" + varInfo.function_name + ") ";
-    ImGui::Text("%s%s =", prefix.c_str(), varInfo.name.c_str());
-    ImGui::SameLine();
+void StepSweep() {
+    if (sweep.phase == Sweep::Phase::Idle) return;
+    if (sessions.empty()) {
+        sweep.phase = Sweep::Phase::Idle;
+        return;
+    }
 
-    if (varInfo.IsAggregateType()) {
-        std::string treeNodeLabel = "##varname" + std::to_string(varInfo.id);
-        if (ImGui::TreeNode(treeNodeLabel.c_str())) {
-            for (auto childVar : varInfo.children) {
-                DisplayVariable(*childVar);
-            }
-            ImGui::TreePop();
-        }
-    } else {
-        std::string inputTextLabel = "##varname" + varInfo.function_name + varInfo.name;
-        if (varInfo.type_class == lldb::eTypeClassEnumeration) {
-            auto members = varInfo.type.GetEnumMembers();
-            auto num_members = members.GetSize();
-            std::vector<std::string> member_names;
-            for (unsigned i = 0; i < num_members; ++i) {
-                auto current_enum_member = members.GetTypeEnumMemberAtIndex(i);
-                if (current_enum_member.IsValid() && std::string(current_enum_member.GetName()) != "") {
-                    member_names.push_back(current_enum_member.GetName());
+    switch (sweep.phase) {
+        case Sweep::Phase::Applying:
+            if (RefreshDone()) {
+                if (sweep.counter) {
+                    sweep.counter_start = SampleCounters();
                 }
+                sweep.gauge_total = 0.0;
+                sweep.gauge_samples = 0;
+                sweep.started = Sweep::Clock::now();
+                sweep.phase = Sweep::Phase::Dwelling;
             }
-            int index = 0;
-            for (auto& n : member_names) {
-                if (varInfo.value == n) {
-                    std::string inputTextLabel = "##sliderEnum" + varInfo.name;
-                    ImGui::SliderInt(inputTextLabel.c_str(), &index, 0, member_names.size() - 1, member_names[index].c_str());
-                    varInfo.value = member_names[index];
-                    break;
+            break;
+        case Sweep::Phase::Dwelling:
+            if (sweep.objective.agent && !sweep.counter) {
+                if (auto sample = SampleGauge()) {
+                    sweep.gauge_total += *sample;
+                    ++sweep.gauge_samples;
                 }
-                ++index;
-            }
-            if (ImGui::IsItemDeactivatedAfterEdit()) {
-                PublishChange(varInfo);
-            }
-        } else if (varInfo.basic_type == lldb::eBasicTypeBool) {
-            bool value = varInfo.value == "true";
-            ImGui::Checkbox(inputTextLabel.c_str(), &value);
-            varInfo.value = value ? "true" : "false";
-            if (ImGui::IsItemDeactivatedAfterEdit()) {
-                PublishChange(varInfo);
             }
-        } else if (varInfo.basic_type == lldb::eBasicTypeUnsignedChar) {
-            uint8_t value = std::stoul(varInfo.value);
-            static auto min = std::numeric_limits<uint8_t>::min();
-            static auto max = std::numeric_limits<uint8_t>::max();
-            ImGui::SliderScalar(inputTextLabel.c_str(), ImGuiDataType_U8, &value, &min , &max);
-            if (ImGui::IsItemDeactivatedAfterEdit()) {
-                PublishChange(varInfo);
-            }
-            ImGui::SameLine(); HelpMarker("CTRL+click to input value");
-            varInfo.value = std::to_string(value);
-        } else if (varInfo.basic_type == lldb::eBasicTypeInt) {
-            int value = std::stoi(varInfo.value);
-            static auto min = std::numeric_limits<int>::min() / 2;
-            static auto max = std::numeric_limits<int>::max() / 2;
-            ImGui::SliderScalar(inputTextLabel.c_str(), ImGuiDataType_S32, &value, &min , &max);
-            if (ImGui::IsItemDeactivatedAfterEdit()) {
-                PublishChange(varInfo);
+            if (Sweep::Clock::now() - sweep.started >= sweep.dwell) {
+                if (sweep.objective.agent) {
+                    FinishSweepValue();
+                } else {
+                    RequestRefresh();
+                    SyncAllSessions();
+                    sweep.phase = Sweep::Phase::Sampling;
+                }
             }
-            ImGui::SameLine(); HelpMarker("CTRL+click to input value");
-            varInfo.value = std::to_string(value);
-        } else {
-            ImGui::InputText(inputTextLabel.c_str(), &varInfo.value, ImGuiInputTextFlags_CharsDecimal);
-            if (ImGui::IsItemDeactivatedAfterEdit()) {
-                PublishChange(varInfo);
+            break;
+        case Sweep::Phase::Sampling:
+            if (RefreshDone()) {
+                FinishSweepValue();
             }
-        }
+            break;
+        case Sweep::Phase::Idle:
+            break;
     }
 }
 
-void FetchNestedMembers(lldb::SBValue& aggregateValue, VariableInfo& parent) {
-    for (int i = 0; i < aggregateValue.GetNumChildren(); ++i) {
-        lldb::SBValue childValue = aggregateValue.GetChildAtIndex(i);
-        if (!childValue.IsValid()) continue;
+void DrawSweep() {
+    if (!sweep_window) return;
 
-        variables.emplace_back(childValue);
-        variables.back().parent = &parent;
-        parent.children.push_back(&variables.back());
-
-        if (parent.children.back()->IsAggregateType()) {
-            FetchNestedMembers(childValue, *parent.children.back());
-        }
+    ImGui::SetNextWindowSize(ImVec2(420, 480), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Parameter sweep", &sweep_window)) {
+        ImGui::End();
+        return;
     }
-}
 
-std::vector<lldb::SBValue> GetVariablesFromThread(lldb::SBThread& thread) {
-    std::vector<lldb::SBValue> variables;
-    for (auto& frame : GetFrames(thread)) {
-        auto frame_vars = GetVariablesFromFrame(frame);
-        variables.insert(variables.end(), frame_vars.begin(), frame_vars.end());
+    static std::vector<VariableRef> candidates;
+    static int input_index = -1;
+    static int objective_index = -1;
+    static bool use_range = true;
+    static double from = 0.0, to = 100.0;
+    static int steps = 11;
+    static int refine_passes = 0;
+    static std::string list = "1, 2, 4, 8";
+    static int dwell_ms = 1000;
+
+    const bool running = sweep.phase != Sweep::Phase::Idle;
+    ImGui::BeginDisabled(running);
+
+    if (ImGui::Button("Refresh variables")) {
+        candidates = GetSweepableVariables();
+        input_index = objective_index = -1;
     }
-    return variables;
-}
 
-void FetchAllVariables() {
-    auto thread = GetThread(process);
-    if (!thread) return;
+    auto combo = [](const char* label, int& index) {
+        std::string preview = index >= 0 && index < (int)candidates.size() ? candidates[index].GetLabel() : "";
+        if (ImGui::BeginCombo(label, preview.c_str())) {
+            for (int i = 0; i < (int)candidates.size(); ++i) {
+                if (ImGui::Selectable(candidates[i].GetLabel().c_str(), i == index)) {
+                    index = i;
+                }
+            }
+            ImGui::EndCombo();
+        }
+    };
+    combo("Input", input_index);
+    combo("Objective", objective_index);
 
-    auto thread_variables = GetVariablesFromThread(thread);
-    
-    variables.clear();
-    variables.reserve(thread_variables.size() * 100);
-
-    for (auto& var : thread_variables) {
-        const VariableInfo varInfo(var);
-        if (std::none_of(variables.begin(), variables.end(), [&varInfo](const VariableInfo& v) {
-            return v.function_name == varInfo.function_name && v.name == varInfo.name;
-        })) {
-            variables.push_back(varInfo);
-            if (varInfo.IsAggregateType()) {
-                FetchNestedMembers(var, variables.back());
+    if (ImGui::RadioButton("Range", use_range)) use_range = true;
+    ImGui::SameLine();
+    if (ImGui::RadioButton("List", !use_range)) use_range = false;
+    if (use_range) {
+        ImGui::InputDouble("From", &from);
+        ImGui::InputDouble("To", &to);
+        ImGui::InputInt("Steps", &steps);
+        ImGui::InputInt("Refine passes", &refine_passes);
+        ImGui::SameLine(); HelpMarker("Re-sweep around the best value with the same number of steps");
+    } else {
+        ImGui::InputText("Values", &list);
+    }
+    ImGui::InputInt("Dwell (ms)", &dwell_ms);
+    ImGui::Checkbox("Counter", &sweep.counter);
+    ImGui::SameLine(); HelpMarker("Report the objective's increase per second instead of its value");
+    ImGui::SameLine();
+    ImGui::Checkbox("Maximize", &sweep.maximize);
+
+    bool ready = input_index >= 0 && objective_index >= 0 && !sessions.empty();
+    ImGui::BeginDisabled(!ready);
+    if (ImGui::Button("Start") && ready) {
+        sweep.input = candidates[input_index];
+        sweep.objective = candidates[objective_index];
+        sweep.dwell = std::chrono::milliseconds(std::max(dwell_ms, 1));
+        sweep.results.clear();
+        sweep.next = 0;
+        sweep.steps = steps;
+        sweep.refine_passes = use_range ? std::max(refine_passes, 0) : 0;
+        if (use_range) {
+            sweep.values = LinearValues(from, to, steps, sweep.input.integral);
+        } else {
+            sweep.values.clear();
+            std::string normalized = list;
+            std::replace(normalized.begin(), normalized.end(), ',', ' ');
+            std::istringstream stream(normalized);
+            double value;
+            while (stream >> value) {
+                sweep.values.push_back(value);
             }
         }
+        if (!sweep.values.empty()) {
+            BeginSweepValue();
+        }
     }
-}
+    ImGui::EndDisabled();
+    ImGui::EndDisabled();
 
-void AttachToProcess(lldb::SBAttachInfo& attachInfo) {
-    target = debugger.CreateTarget("");
-    process = target.Attach(attachInfo, error);
-    if (!process.IsValid() || error.Fail()) {
-        throw std::runtime_error(std::string("Failed to attach to process: ") + error.GetCString());
+    if (running) {
+        ImGui::SameLine();
+        if (ImGui::Button("Stop")) {
+            sweep.phase = Sweep::Phase::Idle;
+        }
+        ImGui::SameLine();
+        ImGui::Text("%s = %g (%zu/%zu)", sweep.input.name.c_str(), sweep.current, sweep.next, sweep.values.size());
     }
-}
 
-void AttachToProcessWithID(lldb::pid_t pid) {
-    lldb::SBAttachInfo attachInfo;
-    attachInfo.SetProcessID(pid);
-    AttachToProcess(attachInfo);
-}
+    if (!sweep.results.empty()) {
+        std::vector<std::pair<double, double>> sorted = sweep.results;
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<float> plot;
+        for (const auto& result : sorted) {
+            plot.push_back(result.second);
+        }
+        ImGui::PlotLines("##sweepplot", plot.data(), (int)plot.size(), 0, sweep.objective.name.c_str(), FLT_MAX, FLT_MAX, ImVec2(-1, 120));
 
-void SetupEventListener() {
-    listener = debugger.GetListener();
-    auto event_mask = lldb::SBProcess::eBroadcastBitStateChanged;
-    auto event_bits = process.GetBroadcaster().AddListener(listener, event_mask);
-    if (event_bits != event_mask) {
-        throw std::runtime_error("Could not set up event listener");
+        const auto* best = BestSweepResult();
+        ImGui::Text("Best: %s = %g (%g)", sweep.input.name.c_str(), best->first, best->second);
+        ImGui::SameLine();
+        ImGui::BeginDisabled(running);
+        if (ImGui::Button("Apply best")) {
+            PublishValue(sweep.input, best->first);
+        }
+        ImGui::EndDisabled();
+
+        if (ImGui::BeginTable("##sweepresults", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY)) {
+            ImGui::TableSetupColumn(sweep.input.name.c_str());
+            ImGui::TableSetupColumn(sweep.objective.name.c_str());
+            ImGui::TableHeadersRow();
+            for (const auto& result : sweep.results) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%g", result.first);
+                ImGui::TableNextColumn();
+                if (&result == best) {
+                    ImGui::TextColored(ImGui::GetStyleColorVec4(ImGuiCol_CheckMark), "%g", result.second);
+                } else {
+                    ImGui::Text("%g", result.second);
+                }
+            }
+            ImGui::EndTable();
+        }
     }
-}
 
-void HandleAttachProcess() {
-    AttachToProcessWithID(pid);
-    SetupEventListener();
-    FetchAllVariables();
-    process.Continue();
+    ImGui::End();
 }
 
 void StyleColorsFunky() {
@@ -512,9 +695,26 @@ void Draw() {
     
     if (ImGui::BeginMenuBar()) {
         if (ImGui::BeginMenu("File")) {
-            if (ImGui::MenuItem("Attach with PID", "Ctrl+A")) {
+            if (ImGui::MenuItem("Attach with PIDs", "Ctrl+A")) {
                 open_pid_popup = true;
             }
+            if (ImGui::MenuItem("Set sync point")) {
+                open_sync_point_popup = true;
+            }
+            ImGui::MenuItem("Parameter sweep", nullptr, &sweep_window);
+            if (ImGui::BeginMenu("Limits")) {
+                // Applied on Enter, so typing 5000 doesn't refetch at 5, 50 and 500 first.
+                TraversalLimits limits = traversal_limits;
+                bool changed = ImGui::InputScalar("Depth", ImGuiDataType_U32, &limits.max_depth, nullptr, nullptr, nullptr, ImGuiInputTextFlags_EnterReturnsTrue);
+                changed |= ImGui::InputScalar("Members per page", ImGuiDataType_U32, &limits.max_children, nullptr, nullptr, nullptr, ImGuiInputTextFlags_EnterReturnsTrue);
+                changed |= ImGui::InputScalar("Nodes per fetch", ImGuiDataType_U64, &limits.max_nodes, nullptr, nullptr, nullptr, ImGuiInputTextFlags_EnterReturnsTrue);
+                if (changed) {
+                    limits.max_children = std::max<uint32_t>(limits.max_children, 1);
+                    limits.max_nodes = std::max<size_t>(limits.max_nodes, 1);
+                    ChangeTraversalLimits(limits);
+                }
+                ImGui::EndMenu();
+            }
             if (ImGui::BeginMenu("Theme")) {
                 if (ImGui::MenuItem("Dark", "Ctrl+D")) {
                     ImGui::StyleColorsDark();
@@ -535,6 +735,9 @@ void Draw() {
             }
             ImGui::EndMenu();
         }
+#ifdef HOOK_COUNT_ALLOCATIONS
+        ImGui::TextDisabled("%llu allocations/frame in view", (unsigned long long)view_allocations);
+#endif
         ImGui::EndMenuBar();
     }
 
@@ -542,29 +745,32 @@ void Draw() {
     ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
     
     if (ImGui::BeginPopup("AttachWithPID", ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove)) {
-        static bool attach_failed = false;
+        static std::string failed_pids;
 
         std::string pidInput;
         pidInput.reserve(64);
-        ImGui::Text("PID:");
+        ImGui::Text("PIDs:");
         ImGui::SameLine();
         ImGui::SetKeyboardFocusHere();
-        if (ImGui::InputText("##pid", &pidInput, ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_CharsDecimal)) {
-            pid = std::stoull(pidInput);
+        if (ImGui::InputText("##pid", &pidInput, ImGuiInputTextFlags_EnterReturnsTrue)) {
+            failed_pids.clear();
             try {
-                HandleAttachProcess();
-                ImGui::CloseCurrentPopup();
-                attach_failed = false;
+                for (auto pid : HandleAttachProcesses(*debugger, ParsePids(pidInput))) {
+                    failed_pids += std::to_string(pid) + " ";
+                }
             } catch (const std::exception& e) {
                 std::cerr << e.what() << std::endl;
-                attach_failed = true;
+                failed_pids = pidInput;
+            }
+            if (failed_pids.empty()) {
+                ImGui::CloseCurrentPopup();
             }
         }
         // TODO: progress bar
 
-        if (attach_failed) {
+        if (!failed_pids.empty()) {
             ImGui::BeginDisabled();
-            ImGui::TextColored(ImVec4{1.000, 0.353, 0.322, 1.0}, "Error: Could not attach to pid %llu", pid);
+            ImGui::TextColored(ImVec4{1.000, 0.353, 0.322, 1.0}, "Error: Could not attach to pids %s", failed_pids.c_str());
             ImGui::EndDisabled();
         }
         ImGui::EndPopup();
@@ -575,54 +781,49 @@ void Draw() {
         ImGui::OpenPopup("AttachWithPID");
     }
 
-    for (auto& var : variables) {
-        if (var.IsRoot()) {
-            DisplayVariable(var);
+    ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+    if (ImGui::BeginPopup("SyncPoint", ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove)) {
+        static std::string spec;
+
+        ImGui::Text("Sync point:");
+        ImGui::SameLine();
+        ImGui::SetKeyboardFocusHere();
+        if (ImGui::InputText("##syncpoint", &spec, ImGuiInputTextFlags_EnterReturnsTrue)) {
+            ChangeSyncPoint(spec);
+            ImGui::CloseCurrentPopup();
         }
+        ImGui::SameLine(); HelpMarker("file:line or function name; leave empty to interrupt the target wherever it is");
+        ImGui::EndPopup();
     }
 
-    ImGui::End();
-    ImGui::Render();
-}
-
-void UpdateVariableValue(const VariableInfo* var_info) {
-    auto thread = GetThread(process);
-    if (!thread) return;
-
-    std::string fully_qualified_name = var_info->GetFullyQualifiedName();
-    std::string expression = fully_qualified_name + " = " + var_info->GetFullyQualifiedValue();
-
-    for (auto& frame : GetFrames(thread)) {
-        lldb::SBValue var = FindVariableById(frame, var_info->GetRoot().id);
-        if (!var) continue;
-
-        lldb::SBValue value = frame.EvaluateExpression(expression.c_str());
-        if (value && value.GetValue()) return;
+    if (open_sync_point_popup) {
+        open_sync_point_popup = false;
+        ImGui::OpenPopup("SyncPoint");
     }
 
-    std::cerr << "Failed to evaluate " << expression << std::endl;
-}
-
-void HandleLLDBProcessEvents() {
-    lldb::SBEvent event;
-    while (listener.PeekAtNextEvent(event)) {
-        if (lldb::SBProcess::EventIsProcessEvent(event)) {
-            lldb::StateType state = lldb::SBProcess::GetStateFromEvent(event);
-
-            if (state == lldb::eStateStopped) {
-                if (!published_changes) {
-                    UpdateVariableValue(current_var_info);
-                    published_changes = true;
-                }
-                FetchAllVariables();
-                process.Continue();
-            }
+    if (!sync_point.empty()) {
+        ImGui::TextDisabled("Sync point: %s", sync_point.c_str());
+    }
+    for (auto& session : sessions) {
+        std::lock_guard lock(session->mutex);
+        if (!session->sync_error.empty()) {
+            ImGui::TextColored(ImVec4{1.000, 0.353, 0.322, 1.0}, "%llu: %s", (unsigned long long)session->pid, session->sync_error.c_str());
         }
-        listener.GetNextEvent(event);
     }
+
+    uint64_t allocations = ThreadAllocations();
+    DisplaySessions();
+    view_allocations = ThreadAllocations() - allocations;
+
+    ImGui::End();
+    DrawSweep();
+    ImGui::Render();
 }
 
 void HandleKeys() {
+    // Keys typed into a text field, such as a sync point name, aren't shortcuts.
+    if (ImGui::GetIO().WantCaptureKeyboard) return;
+
     if (ImGui::IsKeyDown(ImGuiKey_LeftCtrl)) {
         if (ImGui::IsKeyDown(ImGuiKey_A)) {
             open_pid_popup = true;
@@ -638,38 +839,54 @@ void HandleKeys() {
             StyleColorsFunky();
         }
     } else if (ImGui::IsKeyDown(ImGuiKey_S)) {
-        process.Stop();
+        SyncAllSessions();
     }
 }
 
 void core() {
     HandleKeys();
-    HandleLLDBProcessEvents();
+    ReapSessions();
+    InterruptUnhitSyncPoints();
+    StepSweep();
     Draw();
+    BroadcastEdits();
 }
 
 void SetupLoop() {
     IMGUI_CHECKVERSION();
+#ifdef HOOK_COUNT_ALLOCATIONS
+    ImGui::SetAllocatorFunctions(
+        [](size_t size, void*) { CountAllocation(); return std::malloc(size); },
+        [](void* memory, void*) { std::free(memory); });
+#endif
     ImGui::CreateContext();
     StyleColorsBlack();
 }
 
 void TearDownDebugger() {
-    lldb::SBDebugger::Destroy(debugger);
+    for (auto& session : sessions) {
+        StopSession(*session);
+    }
+    sessions.clear();
+    debugger.reset();
 }
 
-void SetupDebugger() {
-    setenv("LLDB_DEBUGSERVER_PATH", GetDebugServerPath().c_str(), 1);
-    lldb::SBDebugger::Initialize();
-    debugger = lldb::SBDebugger::Create();
+// `--mock` attaches to synthetic processes instead of real ones, for
+// exercising the UI without a debugger or a target.
+void SetupDebugger(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--mock") {
+        debugger = std::make_unique<MockDebugger>(MockOptions{});
+    } else {
+        debugger = std::make_unique<LLDBDebugger>();
+    }
 }
 
 }
 
-int main() {
+int main(int argc, char** argv) {
     using namespace Hook;
     try {
-        SetupDebugger();
+        SetupDebugger(argc, argv);
         SetupLoop();
         main_loop(core);
         TearDownDebugger();
@@ -0,0 +1,684 @@
+#include "mock_debugger.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace Hook {
+
+namespace {
+
+enum class Kind : uint8_t {
+    Struct,
+    Int,
+    Float,
+    Bool,
+    Enum,
+    // A pointer to a list element; its children are the element's members.
+    List,
+};
+
+const std::vector<std::string> mock_enumerators = {"Idle", "Busy", "Draining"};
+
+constexpr Address memory_base = 0x100000;
+constexpr Address code_base = 0x400000;
+constexpr Address stack_base = 0x7ff000000000;
+
+struct Node {
+    std::string name;
+    Kind kind = Kind::Struct;
+    uint32_t depth = 0;
+    uint32_t first_child = 0;
+    uint32_t num_children = 0;
+    Address address = 0;
+};
+
+struct FrameLayout {
+    std::string function;
+    std::vector<uint32_t> roots;
+};
+
+void Delay(std::chrono::nanoseconds latency) {
+    using namespace std::chrono_literals;
+    if (latency <= 0ns) return;
+    if (latency >= 100us) {
+        std::this_thread::sleep_for(latency);
+        return;
+    }
+    auto end = std::chrono::steady_clock::now() + latency;
+    while (std::chrono::steady_clock::now() < end) {}
+}
+
+class MockProcess;
+
+class MockValue : public Value {
+public:
+    MockValue(MockProcess& process, uint32_t node, uint32_t frame) : process(process), node(node), frame(frame) {}
+
+    std::string GetName() override;
+    std::string GetFunctionName() override;
+    uint64_t GetID() override;
+    Address GetAddress() override;
+    TypeInfo GetType() override;
+    std::optional<std::string> GetValue() override;
+    uint32_t GetNumChildren() override;
+    ValuePtr GetChildAtIndex(uint32_t index) override;
+
+private:
+    MockProcess& process;
+    uint32_t node;
+    uint32_t frame;
+};
+
+class MockFrame : public Frame {
+public:
+    MockFrame(MockProcess& process, uint32_t frame) : process(process), frame(frame) {}
+
+    std::string GetFunctionName() override;
+    FrameKey GetKey() override;
+    std::vector<ValuePtr> GetVariables() override;
+    bool SetVariable(const std::string& path, const std::string& value) override;
+    bool Evaluate(const std::string& expression) override;
+
+private:
+    MockProcess& process;
+    uint32_t frame;
+};
+
+class MockThread : public Thread {
+public:
+    MockThread(MockProcess& process, uint64_t id) : process(process), id(id) {}
+
+    uint64_t GetID() override {
+        return id;
+    }
+
+    std::vector<FramePtr> GetFrames() override;
+
+private:
+    MockProcess& process;
+    uint64_t id;
+};
+
+class MockProcess : public Process {
+public:
+    MockProcess(const MockOptions& options, std::atomic<uint64_t>& calls, ProcessID pid)
+        : options(options), calls(calls), pid(pid), rng(options.seed ^ (pid * 0x9e3779b97f4a7c15ull)) {
+        for (size_t i = 0; i < options.globals; ++i) {
+            globals.push_back(AddTree("::global_" + std::to_string(i)));
+        }
+        for (size_t f = 0; f < options.frames; ++f) {
+            FrameLayout layout;
+            layout.function = f + 1 == options.frames ? "main" : "mock_function_" + std::to_string(f);
+            for (size_t i = 0; i < options.variables_per_frame; ++i) {
+                layout.roots.push_back(AddTree("local_" + std::to_string(i)));
+            }
+            if (options.list_length > 0) {
+                layout.roots.push_back(AddList("list"));
+            }
+            layout.roots.insert(layout.roots.end(), globals.begin(), globals.end());
+            frames.push_back(std::move(layout));
+        }
+        for (size_t i = 0; i < leaves.size(); ++i) {
+            InitialiseLeaf(nodes[leaves[i]], i);
+        }
+        runner = std::thread(&MockProcess::Run, this);
+    }
+
+    ~MockProcess() override {
+        {
+            std::lock_guard lock(mutex);
+            quit = true;
+        }
+        runner.join();
+    }
+
+    ProcessID GetID() override {
+        return pid;
+    }
+
+    void Stop() override {
+        Delay(options.stop_latency);
+        std::lock_guard lock(mutex);
+        if (state == ProcessState::Running) {
+            PushStop();
+        } else {
+            // Not lost if it races with a continue, like an interrupt that
+            // arrives just after the target resumed.
+            stop_requested = true;
+        }
+    }
+
+    void Continue() override {
+        Delay(options.stop_latency);
+        std::lock_guard lock(mutex);
+        if (state != ProcessState::Stopped) return;
+        Advance(options.iterations_per_continue);
+        state = ProcessState::Running;
+        events.push_back({ProcessState::Running, false});
+        if (stop_requested) {
+            stop_requested = false;
+            PushStop();
+        }
+        events_changed.notify_all();
+    }
+
+    std::vector<ThreadPtr> GetThreads() override {
+        Query();
+        std::vector<ThreadPtr> threads;
+        for (size_t i = 0; i < options.threads; ++i) {
+            threads.push_back(std::make_unique<MockThread>(*this, i + 1));
+        }
+        return threads;
+    }
+
+    ThreadPtr GetSelectedThread() override {
+        Query();
+        return std::make_unique<MockThread>(*this, 1);
+    }
+
+    std::optional<ProcessEvent> WaitForEvent(std::chrono::milliseconds timeout) override {
+        std::unique_lock lock(mutex);
+        if (!events_changed.wait_for(lock, timeout, [this] { return !events.empty(); })) {
+            return std::nullopt;
+        }
+        ProcessEvent event = events.front();
+        events.pop_front();
+        return event;
+    }
+
+    size_t ReadMemory(Address address, void* buffer, size_t size) override {
+        Query();
+        std::lock_guard lock(memory_mutex);
+        if (address < memory_base || address - memory_base + size > memory.size()) return 0;
+        std::memcpy(buffer, memory.data() + (address - memory_base), size);
+        return size;
+    }
+
+    size_t WriteMemory(Address address, const void* buffer, size_t size) override {
+        Query();
+        std::lock_guard lock(memory_mutex);
+        if (address < memory_base || address - memory_base + size > memory.size()) return 0;
+        std::memcpy(memory.data() + (address - memory_base), buffer, size);
+        return size;
+    }
+
+    void SetSyncPoint(const std::string& spec, std::function<void(Thread&)> on_hit) override {
+        Delay(options.stop_latency);
+        // Waits for a hit that is still running the old callback.
+        std::lock_guard callback_lock(callback_mutex);
+        std::lock_guard lock(mutex);
+        sync_set = !spec.empty();
+        sync_armed = false;
+        sync_callback = sync_set ? std::move(on_hit) : nullptr;
+    }
+
+    bool HasSyncPoint() override {
+        std::lock_guard lock(mutex);
+        return sync_set;
+    }
+
+    void ArmSyncPoint(bool armed) override {
+        Delay(options.stop_latency);
+        std::lock_guard lock(mutex);
+        sync_armed = armed;
+    }
+
+    void Query() {
+        ++calls;
+        Delay(options.call_latency);
+    }
+
+    const MockOptions& GetOptions() const {
+        return options;
+    }
+
+    const Node& GetNode(uint32_t index) const {
+        return nodes[index];
+    }
+
+    const FrameLayout& GetFrameLayout(uint32_t frame) const {
+        return frames[frame];
+    }
+
+    size_t GetNumFrames() const {
+        return frames.size();
+    }
+
+    uint64_t GetStops() {
+        std::lock_guard lock(mutex);
+        return stops;
+    }
+
+    std::string FormatLeaf(const Node& node) {
+        uint32_t bits = 0;
+        {
+            std::lock_guard lock(memory_mutex);
+            std::memcpy(&bits, memory.data() + (node.address - memory_base), sizeof(bits));
+        }
+
+        switch (node.kind) {
+            case Kind::Int: {
+                int32_t value;
+                std::memcpy(&value, &bits, sizeof(value));
+                return std::to_string(value);
+            }
+            case Kind::Float: {
+                float value;
+                std::memcpy(&value, &bits, sizeof(value));
+                char text[32];
+                std::snprintf(text, sizeof(text), "%g", value);
+                return text;
+            }
+            case Kind::Bool:
+                return bits ? "true" : "false";
+            case Kind::Enum:
+                return mock_enumerators[bits % mock_enumerators.size()];
+            case Kind::Struct:
+            case Kind::List:
+                break;
+        }
+        return "";
+    }
+
+    bool WriteLeaf(const Node& node, const std::string& text) {
+        uint32_t bits = 0;
+        try {
+            switch (node.kind) {
+                case Kind::Int: {
+                    int32_t value = std::stoi(text);
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    break;
+                }
+                case Kind::Float: {
+                    float value = std::stof(text);
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    break;
+                }
+                case Kind::Bool:
+                    bits = text == "true" || text == "1";
+                    if (!bits && text != "false" && text != "0") return false;
+                    break;
+                case Kind::Enum: {
+                    std::string name = text.substr(text.rfind(':') == std::string::npos ? 0 : text.rfind(':') + 1);
+                    auto it = std::find(mock_enumerators.begin(), mock_enumerators.end(), name);
+                    if (it == mock_enumerators.end()) return false;
+                    bits = it - mock_enumerators.begin();
+                    break;
+                }
+                case Kind::Struct:
+                case Kind::List:
+                    return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+
+        std::lock_guard lock(memory_mutex);
+        std::memcpy(memory.data() + (node.address - memory_base), &bits, sizeof(bits));
+        return true;
+    }
+
+private:
+    uint32_t AddTree(const std::string& name) {
+        uint32_t index = nodes.size();
+        nodes.emplace_back();
+        FillTree(index, name, options.depth);
+        return index;
+    }
+
+    Address AllocateSlot(size_t size) {
+        Address address = memory_base + memory.size();
+        memory.resize(memory.size() + size);
+        return address;
+    }
+
+    uint32_t AddList(const std::string& name) {
+        std::vector<uint32_t> elements;
+        for (size_t i = 0; i < options.list_length; ++i) {
+            uint32_t first = nodes.size();
+            nodes.resize(first + 2);
+            FillTree(first, "value", 0);
+            nodes[first + 1].name = "next";
+            nodes[first + 1].kind = Kind::List;
+            nodes[first + 1].address = AllocateSlot(sizeof(Address));
+            elements.push_back(first);
+        }
+        for (size_t i = 0; i < elements.size(); ++i) {
+            nodes[elements[i] + 1].first_child = elements[(i + 1) % elements.size()];
+            nodes[elements[i] + 1].num_children = 2;
+        }
+
+        uint32_t index = nodes.size();
+        nodes.emplace_back();
+        nodes[index].name = name;
+        nodes[index].kind = Kind::List;
+        nodes[index].address = AllocateSlot(sizeof(Address));
+        nodes[index].first_child = elements.front();
+        nodes[index].num_children = 2;
+        return index;
+    }
+
+    // Members of a struct are laid out contiguously so they can be addressed
+    // by first_child + index.
+    void FillTree(uint32_t index, const std::string& name, size_t depth) {
+        nodes[index].name = name;
+        nodes[index].depth = depth;
+        if (depth == 0 || options.fan_out == 0) {
+            static constexpr Kind leaf_kinds[] = {Kind::Int, Kind::Float, Kind::Bool, Kind::Enum};
+            nodes[index].kind = leaf_kinds[leaves.size() % 4];
+            nodes[index].address = AllocateSlot(sizeof(uint32_t));
+            leaves.push_back(index);
+            return;
+        }
+
+        uint32_t first = nodes.size();
+        nodes.resize(first + options.fan_out);
+        nodes[index].kind = Kind::Struct;
+        nodes[index].first_child = first;
+        nodes[index].num_children = options.fan_out;
+        for (size_t i = 0; i < options.fan_out; ++i) {
+            std::string member = "m";
+            member += std::to_string(i);
+            FillTree(first + i, member, depth - 1);
+        }
+        nodes[index].address = nodes[first].address;
+    }
+
+    void InitialiseLeaf(const Node& node, size_t i) {
+        uint32_t bits = 0;
+        switch (node.kind) {
+            case Kind::Int: {
+                int32_t value = (i * 7) % 1000;
+                std::memcpy(&bits, &value, sizeof(bits));
+                break;
+            }
+            case Kind::Float: {
+                float value = i * 0.5f;
+                std::memcpy(&bits, &value, sizeof(bits));
+                break;
+            }
+            case Kind::Bool:
+                bits = i % 2;
+                break;
+            case Kind::Enum:
+                bits = i % mock_enumerators.size();
+                break;
+            case Kind::Struct:
+            case Kind::List:
+                return;
+        }
+        std::memcpy(memory.data() + (node.address - memory_base), &bits, sizeof(bits));
+    }
+
+    uint64_t NextRandom() {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    }
+
+    // Callers hold `mutex`.
+    void PushStop() {
+        state = ProcessState::Stopped;
+        ++stops;
+        events.push_back({ProcessState::Stopped, false});
+        events_changed.notify_all();
+    }
+
+    // Runs the target's loop: each iteration changes a fraction of the leaves.
+    void Advance(size_t iterations) {
+        if (leaves.empty()) return;
+        size_t changes = iterations * std::max<size_t>(1, options.churn * leaves.size());
+
+        std::lock_guard lock(memory_mutex);
+        for (size_t i = 0; i < changes; ++i) {
+            const Node& node = nodes[leaves[NextRandom() % leaves.size()]];
+            unsigned char* slot = memory.data() + (node.address - memory_base);
+            uint32_t bits;
+            std::memcpy(&bits, slot, sizeof(bits));
+            switch (node.kind) {
+                case Kind::Int:
+                    bits = static_cast<uint32_t>(static_cast<int32_t>(bits) + 1);
+                    break;
+                case Kind::Float: {
+                    float value;
+                    std::memcpy(&value, &bits, sizeof(value));
+                    value += 0.25f;
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    break;
+                }
+                case Kind::Bool:
+                    bits = !bits;
+                    break;
+                case Kind::Enum:
+                    bits = (bits + 1) % mock_enumerators.size();
+                    break;
+                case Kind::Struct:
+                case Kind::List:
+                    break;
+            }
+            std::memcpy(slot, &bits, sizeof(bits));
+        }
+    }
+
+    // Stands in for the target passing its sync point: while running with the
+    // sync point armed, it runs one more loop iteration every loop_period and
+    // calls the breakpoint callback. The data only depends on how often the
+    // target was continued and hit, never on timing.
+    void Run() {
+        while (true) {
+            std::this_thread::sleep_for(options.loop_period);
+
+            std::lock_guard callback_lock(callback_mutex);
+            {
+                std::lock_guard lock(mutex);
+                if (quit) return;
+                if (state != ProcessState::Running || !sync_set || !sync_armed) continue;
+                Advance(1);
+                ++stops;
+            }
+            Delay(options.stop_latency);
+            MockThread thread(*this, 1);
+            sync_callback(thread);
+        }
+    }
+
+    const MockOptions options;
+    std::atomic<uint64_t>& calls;
+    const ProcessID pid;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> leaves;
+    std::vector<uint32_t> globals;
+    std::vector<FrameLayout> frames;
+
+    std::mutex memory_mutex;
+    std::vector<unsigned char> memory;
+
+    std::mutex mutex;
+    std::condition_variable events_changed;
+    std::deque<ProcessEvent> events;
+    ProcessState state = ProcessState::Stopped;
+    uint64_t stops = 0;
+    uint64_t rng;
+    bool quit = false;
+    bool stop_requested = false;
+
+    bool sync_set = false;
+    bool sync_armed = false;
+    // Held while the callback runs, before `mutex`, which the callback may take.
+    std::mutex callback_mutex;
+    std::function<void(Thread&)> sync_callback;
+
+    std::thread runner;
+};
+
+std::string MockValue::GetName() {
+    process.Query();
+    return process.GetNode(node).name;
+}
+
+std::string MockValue::GetFunctionName() {
+    process.Query();
+    return process.GetFrameLayout(frame).function;
+}
+
+uint64_t MockValue::GetID() {
+    return (static_cast<uint64_t>(frame) << 32) | node;
+}
+
+Address MockValue::GetAddress() {
+    process.Query();
+    return process.GetNode(node).address;
+}
+
+TypeInfo MockValue::GetType() {
+    process.Query();
+    TypeInfo info;
+    switch (process.GetNode(node).kind) {
+        case Kind::Struct:
+            info.name = "MockStruct" + std::to_string(process.GetNode(node).depth);
+            info.aggregate = true;
+            break;
+        case Kind::Int:
+            info.name = "int";
+            info.type_class = TypeClass::Builtin;
+            info.basic_type = BasicType::Int;
+            break;
+        case Kind::Float:
+            info.name = "float";
+            info.type_class = TypeClass::Builtin;
+            info.basic_type = BasicType::Float;
+            break;
+        case Kind::Bool:
+            info.name = "bool";
+            info.type_class = TypeClass::Builtin;
+            info.basic_type = BasicType::Bool;
+            break;
+        case Kind::Enum:
+            info.name = "MockMode";
+            info.type_class = TypeClass::Enumeration;
+            info.enumerators = mock_enumerators;
+            break;
+        case Kind::List:
+            info.name = "MockList *";
+            info.aggregate = true;
+            break;
+    }
+    return info;
+}
+
+std::optional<std::string> MockValue::GetValue() {
+    process.Query();
+    const Node& current = process.GetNode(node);
+    if (current.kind == Kind::Struct || current.kind == Kind::List) return std::nullopt;
+    return process.FormatLeaf(current);
+}
+
+uint32_t MockValue::GetNumChildren() {
+    process.Query();
+    return process.GetNode(node).num_children;
+}
+
+ValuePtr MockValue::GetChildAtIndex(uint32_t index) {
+    process.Query();
+    const Node& current = process.GetNode(node);
+    if (index >= current.num_children) return nullptr;
+    return std::make_shared<MockValue>(process, current.first_child + index, frame);
+}
+
+std::string MockFrame::GetFunctionName() {
+    process.Query();
+    return process.GetFrameLayout(frame).function;
+}
+
+FrameKey MockFrame::GetKey() {
+    process.Query();
+    FrameKey key;
+    key.function = code_base + frame * 0x1000;
+    key.cfa = stack_base - (process.GetNumFrames() - frame) * 0x100;
+    key.block_start = key.function;
+    key.block_end = key.function + 0x100;
+    if (frame < process.GetOptions().volatile_frames) {
+        key.block_start += process.GetStops() * 4;
+    }
+    return key;
+}
+
+std::vector<ValuePtr> MockFrame::GetVariables() {
+    process.Query();
+    std::vector<ValuePtr> variables;
+    for (uint32_t root : process.GetFrameLayout(frame).roots) {
+        variables.push_back(std::make_shared<MockValue>(process, root, frame));
+    }
+    return variables;
+}
+
+bool MockFrame::SetVariable(const std::string& path, const std::string& value) {
+    process.Query();
+    std::string root_name = path.substr(0, path.find_first_of(".["));
+    const Node* current = nullptr;
+    for (uint32_t root : process.GetFrameLayout(frame).roots) {
+        const std::string& name = process.GetNode(root).name;
+        if (name == root_name || (name.substr(0, 2) == "::" && name.substr(2) == root_name)) {
+            current = &process.GetNode(root);
+            break;
+        }
+    }
+
+    size_t position = root_name.size();
+    while (current && position < path.size()) {
+        size_t start = position + 1;
+        size_t end = path.find('.', start);
+        std::string member = path.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        const Node* next = nullptr;
+        for (uint32_t i = 0; i < current->num_children; ++i) {
+            if (process.GetNode(current->first_child + i).name == member) {
+                next = &process.GetNode(current->first_child + i);
+                break;
+            }
+        }
+        current = next;
+        position = end == std::string::npos ? path.size() : end;
+    }
+
+    return current && process.WriteLeaf(*current, value);
+}
+
+bool MockFrame::Evaluate(const std::string& expression) {
+    auto equals = expression.find(" = ");
+    if (equals == std::string::npos) return false;
+    std::string path = expression.substr(0, equals);
+    if (path.substr(0, 2) == "::") {
+        path = path.substr(2);
+    }
+    return SetVariable(path, expression.substr(equals + 3));
+}
+
+std::vector<FramePtr> MockThread::GetFrames() {
+    process.Query();
+    std::vector<FramePtr> frames;
+    frames.reserve(process.GetNumFrames());
+    for (uint32_t i = 0; i < process.GetNumFrames(); ++i) {
+        frames.push_back(std::make_unique<MockFrame>(process, i));
+    }
+    return frames;
+}
+
+}
+
+std::unique_ptr<Process> MockDebugger::Attach(ProcessID pid) {
+    if (pid == 0) {
+        throw std::runtime_error("Failed to attach to process: mock processes need a non-zero pid");
+    }
+    Delay(options.stop_latency);
+    return std::make_unique<MockProcess>(options, calls, pid);
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "debugger.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace Hook {
+
+// Shape and timing of the synthetic processes. Every selected thread has
+// `frames` frames, each holding `variables_per_frame` locals plus all
+// `globals`, and every variable is a struct tree `depth` levels deep with
+// `fan_out` members per level, so a stop lists roughly
+// frames * (variables_per_frame + globals) * fan_out^depth leaves.
+struct MockOptions {
+    size_t threads = 1;
+    size_t frames = 8;
+    size_t variables_per_frame = 16;
+    size_t globals = 16;
+    size_t fan_out = 4;
+    size_t depth = 2;
+    // Each frame also holds `list`, a circular linked list of this many
+    // elements, so traversal has a pointer cycle to deal with.
+    size_t list_length = 0;
+    // Innermost frames whose key changes on every stop, like a leaf function
+    // that is called afresh each time.
+    size_t volatile_frames = 1;
+    // Fraction of leaves the running target changes per loop iteration.
+    double churn = 0.01;
+    // Loop iterations the target runs each time it is continued.
+    size_t iterations_per_continue = 1;
+    // Added to every value and frame query, and to every stop, continue or
+    // breakpoint toggle, respectively.
+    std::chrono::nanoseconds call_latency{0};
+    std::chrono::nanoseconds stop_latency{0};
+    // How often the running target passes the sync point while it is armed.
+    std::chrono::microseconds loop_period{1000};
+    uint64_t seed = 1;
+};
+
+// A deterministic in-memory stand-in for a debugger and its targets. Values
+// live in a flat byte array per process; nothing is actually executed.
+class MockDebugger : public Debugger {
+public:
+    explicit MockDebugger(MockOptions options) : options(options) {}
+
+    std::unique_ptr<Process> Attach(ProcessID pid) override;
+
+    const MockOptions options;
+    // Debugger queries served so far, across all processes.
+    std::atomic<uint64_t> calls = 0;
+};
+
+}
@@ -0,0 +1,326 @@
+#include "session.h"
+
+#include <cstddef>
+#include <future>
+#include <iostream>
+
+namespace Hook {
+
+std::vector<std::unique_ptr<Session>> sessions;
+std::vector<Edit> outgoing_edits;
+std::vector<std::string> outgoing_expansions;
+std::string sync_point;
+
+// How long an armed sync point may go unhit, say because its code no longer
+// runs, before the target is interrupted wherever it is instead.
+constexpr std::chrono::seconds sync_timeout{2};
+
+// With a sync point set, the target is only paused when its breakpoint is
+// armed and hit; otherwise it is interrupted wherever it happens to be.
+void RequestSync(Session& session) {
+    if (session.process->HasSyncPoint()) {
+        {
+            std::lock_guard lock(session.mutex);
+            if (!session.sync_armed_at) {
+                session.sync_armed_at = std::chrono::steady_clock::now();
+            }
+        }
+        session.process->ArmSyncPoint(true);
+    } else {
+        session.process->Stop();
+    }
+}
+
+void SyncAllSessions() {
+    for (auto& session : sessions) {
+        RequestSync(*session);
+    }
+}
+
+// Called every frame. The stop applies the waiting work and disarms the
+// sync point.
+void InterruptUnhitSyncPoints() {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& session : sessions) {
+        {
+            std::lock_guard lock(session->mutex);
+            if (!session->sync_armed_at || now - *session->sync_armed_at < sync_timeout) continue;
+            session->sync_armed_at.reset();
+        }
+        session->process->Stop();
+    }
+}
+
+void PublishAssignment(const std::string& function_name, const std::string& fully_qualified_name, const std::string& value) {
+    outgoing_edits.push_back({function_name, fully_qualified_name, value});
+}
+
+void PublishChange(const VariableInfo& varInfo) {
+    PublishAssignment(varInfo.GetRoot().function_name, varInfo.GetFullyQualifiedName(), varInfo.GetFullyQualifiedValue());
+}
+
+void PublishLoadMore(const VariableInfo& placeholder) {
+    if (placeholder.CanLoadMore() && placeholder.parent) {
+        outgoing_expansions.push_back(placeholder.parent->key);
+    }
+}
+
+void BroadcastEdits() {
+    if (outgoing_edits.empty() && outgoing_expansions.empty()) return;
+
+    for (auto& session : sessions) {
+        {
+            std::lock_guard lock(session->mutex);
+            session->pending_edits.insert(session->pending_edits.end(), outgoing_edits.begin(), outgoing_edits.end());
+            session->pending_expansions.insert(session->pending_expansions.end(), outgoing_expansions.begin(), outgoing_expansions.end());
+        }
+        RequestSync(*session);
+    }
+    outgoing_edits.clear();
+    outgoing_expansions.clear();
+}
+
+void PublishAgentChange(const hook::agent::Variable& changed, uint64_t bits) {
+    for (auto& session : sessions) {
+        auto* variable = hook::agent::Find(session->agent, changed.name);
+        if (variable && variable->type == changed.type) {
+            hook::agent::Store(*variable, bits);
+        }
+    }
+}
+
+// Callers hold every session's mutex.
+bool ValueDiverges(const std::string& key, const std::string& value) {
+    for (size_t i = 1; i < sessions.size(); ++i) {
+        auto it = sessions[i]->index.find(key);
+        if (it == sessions[i]->index.end() || it->second->value != value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RefreshSession(Session& session, Thread& thread) {
+    auto stopped_at = std::chrono::steady_clock::now();
+    std::vector<std::string> expansions;
+    TraversalLimits limits;
+    {
+        std::lock_guard lock(session.mutex);
+        expansions.swap(session.pending_expansions);
+        limits = session.limits;
+    }
+    LoadMore(session.frame_cache, expansions);
+
+    std::vector<VariableInfo> variables;
+    FetchAllVariables(thread, session.agent, limits, session.frame_cache, variables);
+    auto index = IndexVariables(variables);
+
+    std::lock_guard lock(session.mutex);
+    session.variables = std::move(variables);
+    session.index = std::move(index);
+    session.stopped_at = stopped_at;
+    session.resumed_at = std::chrono::steady_clock::now();
+    ++session.refreshes;
+}
+
+void RefreshSession(Session& session) {
+    auto thread = session.process->GetSelectedThread();
+    if (!thread) return;
+    RefreshSession(session, *thread);
+}
+
+namespace {
+
+void ApplyPendingEdits(Session& session, Thread& thread) {
+    std::deque<Edit> edits;
+    {
+        std::lock_guard lock(session.mutex);
+        edits.swap(session.pending_edits);
+    }
+    for (const auto& edit : edits) {
+        UpdateVariableValue(thread, edit);
+    }
+}
+
+void SetSessionSyncPoint(Session& session, const std::string& spec) {
+    session.process->SetSyncPoint(spec, [&session](Thread& thread) {
+        ApplyPendingEdits(session, thread);
+        RefreshSession(session, thread);
+
+        std::lock_guard lock(session.mutex);
+        if (session.pending_edits.empty() && session.pending_expansions.empty()) {
+            session.sync_armed_at.reset();
+            session.process->ArmSyncPoint(false);
+        }
+    });
+}
+
+void InstallPendingSyncPoint(Session& session) {
+    std::optional<std::string> spec;
+    {
+        std::lock_guard lock(session.mutex);
+        spec.swap(session.pending_sync_point);
+    }
+    if (spec) {
+        InstallSyncPoint(session, *spec);
+    }
+}
+
+// Takes the sync point out of a target that outlives its session, so the
+// breakpoint neither calls back into the session once it is gone nor keeps
+// pausing the target. Like installing it, this is done while stopped.
+void RemoveSyncPoint(Session& session) {
+    if (!session.process->HasSyncPoint()) return;
+    session.process->Stop();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        auto event = session.process->WaitForEvent(std::chrono::seconds(1));
+        if (!event) continue;
+        if (event->state == ProcessState::Exited) return;
+        if (event->state == ProcessState::Stopped && !event->restarted) {
+            session.process->SetSyncPoint("", nullptr);
+            session.process->Continue();
+            return;
+        }
+    }
+    std::cerr << "Could not stop " << session.pid << " to remove its sync point" << std::endl;
+}
+
+void RunSession(Session& session) {
+    while (session.running) {
+        auto event = session.process->WaitForEvent(std::chrono::seconds(1));
+        if (!event) continue;
+
+        if (event->state == ProcessState::Stopped && !event->restarted) {
+            InstallPendingSyncPoint(session);
+            auto thread = session.process->GetSelectedThread();
+            if (thread) {
+                ApplyPendingEdits(session, *thread);
+                RefreshSession(session, *thread);
+                // Whatever the sync point was armed for has been done here.
+                std::lock_guard lock(session.mutex);
+                if (session.sync_armed_at && session.pending_edits.empty() && session.pending_expansions.empty()) {
+                    session.sync_armed_at.reset();
+                    session.process->ArmSyncPoint(false);
+                }
+            }
+            session.process->Continue();
+        } else if (event->state == ProcessState::Exited) {
+            session.running = false;
+            return;
+        }
+    }
+    RemoveSyncPoint(session);
+}
+
+}
+
+// Only called while the process is stopped, so the breakpoint is never live
+// before its callback is attached and no callback is running.
+void InstallSyncPoint(Session& session, const std::string& spec) {
+    std::string error;
+    try {
+        SetSessionSyncPoint(session, spec);
+    } catch (const std::exception& e) {
+        error = e.what();
+        std::cerr << error << std::endl;
+    }
+    std::lock_guard lock(session.mutex);
+    session.sync_error = std::move(error);
+}
+
+// Every session, including ones attached later, gets the same spec. It is
+// installed at each session's next stop; failures are kept per session.
+void ChangeSyncPoint(const std::string& spec) {
+    sync_point = spec;
+    for (auto& session : sessions) {
+        {
+            std::lock_guard lock(session->mutex);
+            session->pending_sync_point = spec;
+        }
+        session->process->Stop();
+    }
+}
+
+// Maps the agent segment named after the process, unless it was left behind
+// by an earlier process with the same pid: only the owner holds the
+// segment's nonce at the address it mapped it.
+hook::agent::Segment* OpenAgent(Process& process, ProcessID pid) {
+    hook::agent::Segment* segment = hook::agent::Open(pid);
+    if (!segment) return nullptr;
+
+    uint64_t nonce = 0;
+    Address address = segment->address + offsetof(hook::agent::Segment, nonce);
+    if (process.ReadMemory(address, &nonce, sizeof(nonce)) != sizeof(nonce) || nonce != segment->nonce) {
+        std::cerr << "Ignoring stale agent segment of process " << pid << std::endl;
+        hook::agent::Close(segment);
+        return nullptr;
+    }
+    return segment;
+}
+
+// Each session picks the new limits up at its next fetch, which this
+// triggers so the view reflects them.
+void ChangeTraversalLimits(const TraversalLimits& limits) {
+    traversal_limits = limits;
+    for (auto& session : sessions) {
+        {
+            std::lock_guard lock(session->mutex);
+            session->limits = limits;
+        }
+        RequestSync(*session);
+    }
+}
+
+// Runs off the UI thread, but only while it waits for the attach to finish.
+std::unique_ptr<Session> StartSession(Debugger& debugger, ProcessID pid) {
+    auto session = std::make_unique<Session>(pid, debugger.Attach(pid));
+    session->limits = traversal_limits;
+    session->agent = OpenAgent(*session->process, pid);
+    RefreshSession(*session);
+    InstallSyncPoint(*session, sync_point);
+    session->running = true;
+    session->process->Continue();
+    session->worker = std::thread(RunSession, std::ref(*session));
+    return session;
+}
+
+// The worker removes the sync point on its way out; the process itself goes
+// first when the session is destroyed.
+void StopSession(Session& session) {
+    session.running = false;
+    if (session.worker.joinable()) {
+        session.worker.join();
+    }
+    hook::agent::Close(session.agent);
+    session.agent = nullptr;
+}
+
+void ReapSessions() {
+    std::erase_if(sessions, [](const std::unique_ptr<Session>& session) {
+        if (session->running) return false;
+        StopSession(*session);
+        return true;
+    });
+}
+
+std::vector<ProcessID> HandleAttachProcesses(Debugger& debugger, const std::vector<ProcessID>& pids) {
+    std::vector<std::future<std::unique_ptr<Session>>> attaching;
+    for (auto pid : pids) {
+        attaching.push_back(std::async(std::launch::async, StartSession, std::ref(debugger), pid));
+    }
+
+    std::vector<ProcessID> failed;
+    for (size_t i = 0; i < attaching.size(); ++i) {
+        try {
+            sessions.push_back(attaching[i].get());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            failed.push_back(pids[i]);
+        }
+    }
+    return failed;
+}
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "debugger.h"
+#include "hook_agent.h"
+#include "variables.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Hook {
+
+// One attached process. Its worker thread handles stop events, applies the
+// edits queued for it and republishes `variables` under `mutex`.
+struct Session {
+    Session(ProcessID pid, std::unique_ptr<Process> process) : pid(pid), process(std::move(process)) {}
+
+    ProcessID pid = 0;
+    hook::agent::Segment* agent = nullptr;
+
+    std::mutex mutex;
+    std::vector<VariableInfo> variables;
+    std::unordered_map<std::string, const VariableInfo*> index;
+    // When the target stopped for the fetch that produced `variables`, and
+    // when the fetch was done and the target about to resume.
+    std::chrono::steady_clock::time_point stopped_at;
+    std::chrono::steady_clock::time_point resumed_at;
+    std::deque<Edit> pending_edits;
+    std::vector<std::string> pending_expansions;
+    // Copied from traversal_limits by the UI thread, read by each fetch.
+    TraversalLimits limits;
+    // A sync point to install at the next stop, and why the last one failed.
+    std::optional<std::string> pending_sync_point;
+    std::string sync_error;
+    // When the sync point was armed for work that is still waiting for a hit.
+    std::optional<std::chrono::steady_clock::time_point> sync_armed_at;
+    FrameCache frame_cache;
+
+    std::thread worker;
+    std::atomic<bool> running = false;
+    std::atomic<uint64_t> refreshes = 0;
+
+    // Declared last so it is destroyed first: its sync point callback uses
+    // the members above, and tearing it down waits for a hit in progress.
+    std::unique_ptr<Process> process;
+};
+
+extern std::vector<std::unique_ptr<Session>> sessions;
+extern std::vector<Edit> outgoing_edits;
+extern std::vector<std::string> outgoing_expansions;
+extern std::string sync_point;
+
+void RequestSync(Session& session);
+void SyncAllSessions();
+void InterruptUnhitSyncPoints();
+
+void PublishAssignment(const std::string& function_name, const std::string& fully_qualified_name, const std::string& value);
+void PublishChange(const VariableInfo& varInfo);
+void PublishLoadMore(const VariableInfo& placeholder);
+void BroadcastEdits();
+void PublishAgentChange(const hook::agent::Variable& changed, uint64_t bits);
+
+bool ValueDiverges(const std::string& key, const std::string& value);
+
+void RefreshSession(Session& session, Thread& thread);
+void RefreshSession(Session& session);
+void InstallSyncPoint(Session& session, const std::string& spec);
+void ChangeSyncPoint(const std::string& spec);
+void ChangeTraversalLimits(const TraversalLimits& limits);
+
+std::unique_ptr<Session> StartSession(Debugger& debugger, ProcessID pid);
+void StopSession(Session& session);
+void ReapSessions();
+std::vector<ProcessID> HandleAttachProcesses(Debugger& debugger, const std::vector<ProcessID>& pids);
+
+}
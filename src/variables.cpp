@@ -0,0 +1,338 @@
+#include "variables.h"
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_set>
+
+namespace Hook {
+
+TraversalLimits traversal_limits;
+
+VariableInfo::VariableInfo(Value& value) {
+    this->name = value.GetName();
+    this->function_name = (name.substr(0,2) == "::") ? "" : value.GetFunctionName();
+    this->id = value.GetID();
+
+    TypeInfo type = value.GetType();
+    this->type_name = std::move(type.name);
+    this->type_class = type.type_class;
+    this->basic_type = type.basic_type;
+    this->enum_members = std::move(type.enumerators);
+
+    this->is_nested = type.aggregate;
+    if (!this->is_nested) {
+        auto current = value.GetValue();
+        this->readable = current.has_value();
+        this->value = current.value_or("");
+    }
+}
+
+namespace {
+
+bool FrameHoldsVariable(Frame& frame, const std::string& function_name) {
+    return function_name.empty() || function_name == frame.GetFunctionName();
+}
+
+// Walks one frame's variables depth first. `path` holds the (address, type)
+// of the aggregates above the current node, so a member that leads back to
+// one of them is a cycle.
+struct Traversal {
+    CachedFrame& frame;
+    const FrameCache& cache;
+    std::vector<std::pair<Address, size_t>> path;
+};
+
+// The nodes of a fetch that the frames and globals before this one left.
+struct FetchBudget {
+    size_t remaining;
+
+    void Spend(const CachedFrame& cached) {
+        remaining -= std::min(remaining, cached.nodes.size());
+    }
+};
+
+size_t AddNode(CachedFrame& frame, VariableInfo node, ValuePtr value, size_t parent) {
+    size_t index = frame.nodes.size();
+    frame.nodes.push_back(std::move(node));
+    frame.values.push_back(std::move(value));
+    frame.parents.push_back(parent);
+    frame.child_counts.push_back(0);
+    return index;
+}
+
+void AddPlaceholder(CachedFrame& frame, size_t parent, Placeholder kind, uint32_t hidden) {
+    VariableInfo placeholder;
+    placeholder.name = "...";
+    placeholder.placeholder = kind;
+    placeholder.hidden_children = hidden;
+    AddNode(frame, std::move(placeholder), nullptr, parent);
+}
+
+// Same as VariableInfo::GetKey, for a node that is not linked yet.
+std::string GetCachedKey(const CachedFrame& frame, size_t index) {
+    std::string name;
+    size_t root = index;
+    for (size_t current = index; current != no_parent; current = frame.parents[current]) {
+        const VariableInfo& node = frame.nodes[current];
+        name = node.name + name;
+        if (frame.parents[current] != no_parent && !node.ParentIsContainer()) {
+            name = "." + name;
+        }
+        root = current;
+    }
+    return frame.nodes[root].function_name + "|" + name;
+}
+
+uint32_t GetExpansion(const Traversal& traversal, size_t index) {
+    if (traversal.cache.expansions.empty()) return 0;
+    auto it = traversal.cache.expansions.find(GetCachedKey(traversal.frame, index));
+    return it == traversal.cache.expansions.end() ? 0 : it->second;
+}
+
+bool IsOnPath(const Traversal& traversal, Address address, const std::string& type_name) {
+    if (address == 0) return false;
+    for (const auto& [ancestor_address, ancestor] : traversal.path) {
+        if (ancestor_address == address && traversal.frame.nodes[ancestor].type_name == type_name) return true;
+    }
+    return false;
+}
+
+void FetchNestedMembers(Traversal& traversal, Value& aggregateValue, size_t parent, uint32_t depth) {
+    CachedFrame& frame = traversal.frame;
+    const TraversalLimits& limits = traversal.cache.limits;
+
+    const uint32_t num_children = aggregateValue.GetNumChildren();
+    frame.child_counts[parent] = num_children;
+    if (num_children == 0) return;
+
+    // Aggregates the user expanded are listed regardless of depth and budget,
+    // and their members start counting depth afresh.
+    const uint32_t pages = GetExpansion(traversal, parent);
+    if (pages > 0) {
+        depth = 0;
+    } else if (depth >= limits.max_depth) {
+        AddPlaceholder(frame, parent, Placeholder::DepthLimit, num_children);
+        return;
+    } else if (frame.nodes.size() >= frame.budget) {
+        AddPlaceholder(frame, parent, Placeholder::NodeBudget, num_children);
+        frame.over_budget = true;
+        return;
+    }
+
+    const uint32_t listed = std::min<uint64_t>(num_children, uint64_t(limits.max_children) * (pages + 1));
+    for (uint32_t i = 0; i < listed; ++i) {
+        ValuePtr childValue = aggregateValue.GetChildAtIndex(i);
+        if (!childValue) continue;
+
+        size_t child = AddNode(frame, VariableInfo(*childValue), childValue, parent);
+        if (!frame.nodes[child].IsAggregateType()) continue;
+
+        Address address = childValue->GetAddress();
+        if (IsOnPath(traversal, address, frame.nodes[child].type_name)) {
+            frame.child_counts[child] = childValue->GetNumChildren();
+            AddPlaceholder(frame, child, Placeholder::Cycle, 0);
+            continue;
+        }
+
+        traversal.path.emplace_back(address, child);
+        FetchNestedMembers(traversal, *childValue, child, depth + 1);
+        traversal.path.pop_back();
+    }
+
+    if (listed < num_children) {
+        AddPlaceholder(frame, parent, Placeholder::MoreChildren, num_children - listed);
+    }
+}
+
+void AddRoot(Traversal& traversal, const ValuePtr& var) {
+    CachedFrame& cached = traversal.frame;
+    size_t root = AddNode(cached, VariableInfo(*var), var, no_parent);
+    if (cached.nodes[root].IsAggregateType()) {
+        traversal.path.assign(1, {var->GetAddress(), root});
+        FetchNestedMembers(traversal, *var, root, 0);
+    }
+}
+
+void ClearCachedFrame(CachedFrame& cached, size_t budget) {
+    cached.nodes.clear();
+    cached.values.clear();
+    cached.parents.clear();
+    cached.child_counts.clear();
+    cached.budget = budget;
+    cached.over_budget = false;
+}
+
+// Lists a frame's locals. Globals are only registered with the cache here,
+// to be listed by BuildStatic.
+void BuildCachedFrame(Frame& frame, const hook::agent::Segment* agent, FrameCache& cache, CachedFrame& cached, size_t budget) {
+    ClearCachedFrame(cached, budget);
+
+    Traversal traversal{cached, cache, {}};
+    for (auto& var : frame.GetVariables()) {
+        std::string var_name = var->GetName();
+        if (var_name.substr(0, 2) == "::") {
+            // Agent knobs are shown from shared memory instead.
+            if (hook::agent::Find(agent, var_name.c_str() + 2)) continue;
+            auto [it, inserted] = cache.statics.try_emplace(var_name);
+            if (inserted) {
+                it->second.values.push_back(var);
+                cache.static_order.push_back(var_name);
+            }
+            continue;
+        }
+        AddRoot(traversal, var);
+    }
+}
+
+void BuildStatic(const FrameCache& cache, CachedFrame& cached, size_t budget) {
+    ValuePtr root = cached.values.front();
+    ClearCachedFrame(cached, budget);
+    Traversal traversal{cached, cache, {}};
+    AddRoot(traversal, root);
+}
+
+// Re-reads the leaf values of a frame built at an earlier stop. Fails if the
+// shape of any aggregate changed, a leaf became readable or unreadable, or
+// the frame would be cut off elsewhere with the budget it has now, in which
+// case the frame has to be rebuilt.
+bool RefreshCachedFrame(CachedFrame& cached, size_t budget) {
+    if (cached.over_budget ? budget != cached.budget : cached.nodes.size() > budget) return false;
+    for (size_t i = 0; i < cached.nodes.size(); ++i) {
+        if (cached.nodes[i].IsPlaceholder()) continue;
+        if (cached.nodes[i].IsAggregateType()) {
+            if (cached.values[i]->GetNumChildren() != cached.child_counts[i]) return false;
+            continue;
+        }
+        auto value = cached.values[i]->GetValue();
+        if (value.has_value() != cached.nodes[i].readable) return false;
+        if (value) {
+            cached.nodes[i].value = std::move(*value);
+        }
+    }
+    return true;
+}
+
+const CachedFrame& GetCachedFrame(FrameCache& cache, Frame& frame, const hook::agent::Segment* agent, size_t budget) {
+    auto [it, inserted] = cache.frames.try_emplace(frame.GetKey());
+    CachedFrame& cached = it->second;
+    if (inserted || !RefreshCachedFrame(cached, budget)) {
+        BuildCachedFrame(frame, agent, cache, cached, budget);
+    }
+    cached.generation = cache.generation;
+    return cached;
+}
+
+void AppendCachedFrame(const CachedFrame& cached, std::unordered_set<std::string>& roots, std::vector<VariableInfo>& variables, std::vector<size_t>& parents) {
+    std::vector<size_t> mapped(cached.nodes.size(), no_parent);
+    bool keep = false;
+    for (size_t i = 0; i < cached.nodes.size(); ++i) {
+        const VariableInfo& node = cached.nodes[i];
+        if (cached.parents[i] == no_parent) {
+            keep = roots.insert(node.function_name + "|" + node.name).second;
+        }
+        if (!keep) continue;
+
+        mapped[i] = variables.size();
+        variables.push_back(node);
+        parents.push_back(cached.parents[i] == no_parent ? no_parent : mapped[cached.parents[i]]);
+    }
+}
+
+void ClearCachedFrames(FrameCache& cache) {
+    cache.frames.clear();
+    cache.statics.clear();
+    cache.static_order.clear();
+}
+
+void LinkVariables(std::vector<VariableInfo>& variables, const std::vector<size_t>& parents) {
+    for (size_t i = 0; i < variables.size(); ++i) {
+        variables[i].children.clear();
+        variables[i].parent = nullptr;
+    }
+    for (size_t i = 0; i < variables.size(); ++i) {
+        if (parents[i] == no_parent) continue;
+        variables[i].parent = &variables[parents[i]];
+        variables[parents[i]].children.push_back(&variables[i]);
+    }
+}
+
+}
+
+// Each request lists another page of the aggregate's members, or lifts the
+// depth and node limits for it. Cached frames are dropped so the next fetch
+// lists them with the new limits.
+void LoadMore(FrameCache& cache, const std::vector<std::string>& keys) {
+    if (keys.empty()) return;
+    for (const auto& key : keys) {
+        ++cache.expansions[key];
+    }
+    ClearCachedFrames(cache);
+}
+
+// Frames that are still live and unchanged since the last stop come from the
+// cache with only their leaf values re-read; the rest are listed afresh, as
+// is everything once the limits change. Globals follow the locals of all
+// frames.
+void FetchAllVariables(Thread& thread, const hook::agent::Segment* agent, const TraversalLimits& limits, FrameCache& cache, std::vector<VariableInfo>& variables) {
+    if (limits != cache.limits) {
+        ClearCachedFrames(cache);
+        cache.limits = limits;
+    }
+
+    variables.clear();
+    std::vector<size_t> parents;
+    std::unordered_set<std::string> roots;
+    FetchBudget budget{limits.max_nodes};
+    ++cache.generation;
+
+    for (auto& frame : thread.GetFrames()) {
+        const CachedFrame& cached = GetCachedFrame(cache, *frame, agent, budget.remaining);
+        budget.Spend(cached);
+        AppendCachedFrame(cached, roots, variables, parents);
+    }
+
+    for (const auto& name : cache.static_order) {
+        CachedFrame& cached = cache.statics[name];
+        if (cached.nodes.empty() || !RefreshCachedFrame(cached, budget.remaining)) {
+            BuildStatic(cache, cached, budget.remaining);
+        }
+        budget.Spend(cached);
+        AppendCachedFrame(cached, roots, variables, parents);
+    }
+
+    std::erase_if(cache.frames, [&cache](const auto& entry) {
+        return entry.second.generation != cache.generation;
+    });
+
+    LinkVariables(variables, parents);
+}
+
+std::unordered_map<std::string, const VariableInfo*> IndexVariables(std::vector<VariableInfo>& variables) {
+    std::unordered_map<std::string, const VariableInfo*> index;
+    index.reserve(variables.size());
+    for (auto& var : variables) {
+        if (var.IsPlaceholder()) continue;
+        var.key = var.GetKey();
+        index.emplace(var.key, &var);
+    }
+    return index;
+}
+
+// Writes the value straight into the variable's memory when the debugger can
+// parse it, which needs no code to run in the target; anything else
+// (enumerators, for one) goes through the expression evaluator.
+void UpdateVariableValue(Thread& thread, const Edit& edit) {
+    std::string path = edit.fully_qualified_name.substr(0, 2) == "::" ? edit.fully_qualified_name.substr(2) : edit.fully_qualified_name;
+    std::string expression = edit.GetExpression();
+
+    for (auto& frame : thread.GetFrames()) {
+        if (!FrameHoldsVariable(*frame, edit.function_name)) continue;
+
+        if (frame->SetVariable(path, edit.value)) return;
+        if (frame->Evaluate(expression)) return;
+    }
+
+    std::cerr << "Failed to evaluate " << expression << std::endl;
+}
+
+}
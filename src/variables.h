@@ -0,0 +1,174 @@
+#pragma once
+
+#include "debugger.h"
+#include "hook_agent.h"
+
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Hook {
+
+// Listing a frame stops descending at these limits and leaves a placeholder
+// where it stopped, so its cost stays bounded however deep, wide or cyclic
+// the program's data is.
+struct TraversalLimits {
+    uint32_t max_depth = 8;
+    uint32_t max_children = 256;
+    // Shared by all frames and globals of one fetch.
+    size_t max_nodes = 100000;
+
+    bool operator==(const TraversalLimits&) const = default;
+};
+
+// The limits set in the UI, which new sessions start with. Only the UI thread
+// touches them; fetches use their session's own copy.
+extern TraversalLimits traversal_limits;
+
+enum class Placeholder {
+    None,
+    MoreChildren,
+    DepthLimit,
+    NodeBudget,
+    Cycle,
+};
+
+struct VariableInfo {
+    VariableInfo(Value& value);
+
+    VariableInfo() = default;
+
+    bool IsAggregateType() const {
+        return is_nested;
+    }
+
+    bool IsPlaceholder() const {
+        return placeholder != Placeholder::None;
+    }
+
+    // Everything but a cycle can be listed further on request.
+    bool CanLoadMore() const {
+        return IsPlaceholder() && placeholder != Placeholder::Cycle;
+    }
+
+    std::string GetFullyQualifiedValue() const {
+        if (type_class == TypeClass::Enumeration) {
+            return type_name + "::" + value;
+        } else {
+            return value;
+        }
+    }
+
+    const VariableInfo& GetRoot() const {
+        const VariableInfo* root = this;
+        while (root->parent) {
+            root = root->parent;
+        }
+        return *root;
+    }
+
+    bool IsRoot() const {
+        return !parent;
+    }
+
+    bool ParentIsContainer() const {
+        return name.back() == ']';
+    }
+
+    std::string GetFullyQualifiedName() const {
+        std::string full_name;
+        const VariableInfo* current = this;
+        while (current != nullptr) {
+            full_name = current->name + full_name;
+            if (!current->IsRoot() && !current->ParentIsContainer()) {
+                full_name = "." + full_name;
+            }
+            current = current->parent;
+        }
+        return full_name;
+    }
+
+    std::string GetKey() const {
+        return GetRoot().function_name + "|" + GetFullyQualifiedName();
+    }
+
+    std::string name;
+    std::string function_name;
+    std::string value;
+    std::string type_name;
+    TypeClass type_class = TypeClass::Other;
+    BasicType basic_type = BasicType::Other;
+    std::vector<std::string> enum_members;
+    bool is_nested = false;
+    // False for leaves the debugger could not read, such as optimized-out locals.
+    bool readable = true;
+    Placeholder placeholder = Placeholder::None;
+    uint32_t hidden_children = 0;
+    // GetKey(), filled in by IndexVariables so drawing doesn't rebuild it.
+    std::string key;
+    uint64_t id = std::numeric_limits<uint64_t>::max();
+    std::vector<VariableInfo*> children;
+    VariableInfo* parent = nullptr;
+};
+
+struct Edit {
+    std::string function_name;
+    std::string fully_qualified_name;
+    std::string value;
+
+    std::string GetExpression() const {
+        return fully_qualified_name + " = " + value;
+    }
+};
+
+struct FrameKeyHash {
+    size_t operator()(const FrameKey& key) const {
+        size_t hash = std::hash<Address>{}(key.function);
+        for (auto part : {key.cfa, key.block_start, key.block_end}) {
+            hash ^= std::hash<Address>{}(part) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+};
+
+// Variables of one frame in depth-first order. Parents are stored as indices
+// so the nodes can be copied into a session's variable list and linked there.
+struct CachedFrame {
+    std::vector<VariableInfo> nodes;
+    std::vector<ValuePtr> values;
+    std::vector<size_t> parents;
+    std::vector<uint32_t> child_counts;
+    uint64_t generation = 0;
+    // Nodes the fetch had left for this frame when it was built, and whether
+    // it ran out of them.
+    size_t budget = 0;
+    bool over_budget = false;
+};
+
+// `expansions` maps the keys of aggregates the user asked to see more of to
+// the number of extra pages of members to list for them.
+struct FrameCache {
+    std::unordered_map<FrameKey, CachedFrame, FrameKeyHash> frames;
+    // Globals are in scope in every frame, so they are kept apart from the
+    // frames, one tree per name in the order first seen, and listed and
+    // refreshed once per fetch.
+    std::unordered_map<std::string, CachedFrame> statics;
+    std::vector<std::string> static_order;
+    std::unordered_map<std::string, uint32_t> expansions;
+    // The limits the cached frames were listed with.
+    TraversalLimits limits;
+    uint64_t generation = 0;
+};
+
+constexpr size_t no_parent = std::numeric_limits<size_t>::max();
+
+void LoadMore(FrameCache& cache, const std::vector<std::string>& keys);
+
+void FetchAllVariables(Thread& thread, const hook::agent::Segment* agent, const TraversalLimits& limits, FrameCache& cache, std::vector<VariableInfo>& variables);
+
+std::unordered_map<std::string, const VariableInfo*> IndexVariables(std::vector<VariableInfo>& variables);
+
+void UpdateVariableValue(Thread& thread, const Edit& edit);
+
+}
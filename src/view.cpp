@@ -0,0 +1,308 @@
+#include "view.h"
+#include "session.h"
+
+#include <imgui.h>
+#include <imgui_stdlib.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Hook {
+
+void HelpMarker(const char* desc) {
+    ImGui::TextDisabled("(?)");
+    if (ImGui::BeginItemTooltip()) {
+        ImGui::PushTextWrapPos(ImGui::GetFontSize() * 35.0f);
+        ImGui::TextUnformatted(desc);
+        ImGui::PopTextWrapPos();
+        ImGui::EndTooltip();
+    }
+}
+
+bool expand_variables = false;
+
+namespace {
+
+// Holds every session's mutex, like a vector of locks but without
+// allocating one each frame.
+class SessionsLock {
+public:
+    SessionsLock() {
+        for (auto& session : sessions) {
+            session->mutex.lock();
+        }
+    }
+
+    ~SessionsLock() {
+        for (auto& session : sessions) {
+            session->mutex.unlock();
+        }
+    }
+};
+
+// Writes `value` back into the variable's text without allocating unless
+// the text outgrows its buffer.
+template <typename T>
+void StoreNumber(VariableInfo& varInfo, T value) {
+    char text[32];
+    auto [end, error] = std::to_chars(text, text + sizeof(text), value);
+    varInfo.value.assign(text, end);
+}
+
+void DisplayDivergence(const VariableInfo& varInfo) {
+    if (sessions.size() < 2) return;
+
+    const std::string& key = varInfo.key;
+    if (!ValueDiverges(key, varInfo.value)) return;
+
+    ImGui::SameLine();
+    ImGui::TextColored(ImVec4{1.000, 0.353, 0.322, 1.0}, "(!)");
+    if (ImGui::BeginItemTooltip()) {
+        for (auto& session : sessions) {
+            auto it = session->index.find(key);
+            ImGui::Text("%llu: %s", (unsigned long long)session->pid, it == session->index.end() ? "<missing>" : it->second->value.c_str());
+        }
+        ImGui::EndTooltip();
+    }
+}
+
+void DisplayPlaceholder(const VariableInfo& placeholder) {
+    switch (placeholder.placeholder) {
+        case Placeholder::MoreChildren:
+            ImGui::TextDisabled("%u more members", placeholder.hidden_children);
+            break;
+        case Placeholder::DepthLimit:
+            ImGui::TextDisabled("%u members below the depth limit", placeholder.hidden_children);
+            break;
+        case Placeholder::NodeBudget:
+            ImGui::TextDisabled("%u members over the node budget", placeholder.hidden_children);
+            break;
+        default:
+            ImGui::TextDisabled("cycle: refers back to an enclosing object");
+            break;
+    }
+
+    if (placeholder.CanLoadMore()) {
+        ImGui::SameLine();
+        ImGui::PushID(&placeholder);
+        if (ImGui::SmallButton("Load more")) {
+            PublishLoadMore(placeholder);
+        }
+        ImGui::PopID();
+    }
+}
+
+ImGuiDataType ToImGuiDataType(hook::agent::Type type) {
+    switch (type) {
+        case hook::agent::Type::Int8: return ImGuiDataType_S8;
+        case hook::agent::Type::UInt8: return ImGuiDataType_U8;
+        case hook::agent::Type::Int16: return ImGuiDataType_S16;
+        case hook::agent::Type::UInt16: return ImGuiDataType_U16;
+        case hook::agent::Type::Int32: return ImGuiDataType_S32;
+        case hook::agent::Type::UInt32: return ImGuiDataType_U32;
+        case hook::agent::Type::Int64: return ImGuiDataType_S64;
+        case hook::agent::Type::Float: return ImGuiDataType_Float;
+        case hook::agent::Type::Double: return ImGuiDataType_Double;
+        default: return ImGuiDataType_U64;
+    }
+}
+
+// Formats the raw bits of an agent slot as the variable's type.
+void FormatAgentValue(char* text, size_t size, hook::agent::Type type, uint64_t bits) {
+    switch (type) {
+        case hook::agent::Type::Bool: std::snprintf(text, size, "%s", bits ? "true" : "false"); break;
+        case hook::agent::Type::Int8: std::snprintf(text, size, "%d", int(int8_t(bits))); break;
+        case hook::agent::Type::UInt8: std::snprintf(text, size, "%u", unsigned(uint8_t(bits))); break;
+        case hook::agent::Type::Int16: std::snprintf(text, size, "%d", int(int16_t(bits))); break;
+        case hook::agent::Type::UInt16: std::snprintf(text, size, "%u", unsigned(uint16_t(bits))); break;
+        case hook::agent::Type::Int32: std::snprintf(text, size, "%d", int32_t(bits)); break;
+        case hook::agent::Type::UInt32: std::snprintf(text, size, "%u", uint32_t(bits)); break;
+        case hook::agent::Type::Int64: std::snprintf(text, size, "%lld", (long long)int64_t(bits)); break;
+        case hook::agent::Type::Float: {
+            uint32_t raw = bits;
+            float value;
+            std::memcpy(&value, &raw, sizeof(value));
+            std::snprintf(text, size, "%g", value);
+            break;
+        }
+        case hook::agent::Type::Double: {
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            std::snprintf(text, size, "%g", value);
+            break;
+        }
+        default: std::snprintf(text, size, "%llu", (unsigned long long)bits); break;
+    }
+}
+
+void DisplayAgentDivergence(const hook::agent::Variable& variable, uint64_t bits) {
+    if (sessions.size() < 2) return;
+
+    bool diverged = false;
+    for (size_t i = 1; i < sessions.size() && !diverged; ++i) {
+        auto* other = hook::agent::Find(sessions[i]->agent, variable.name);
+        diverged = !other || hook::agent::Load(*other) != bits;
+    }
+    if (!diverged) return;
+
+    ImGui::SameLine();
+    ImGui::TextColored(ImVec4{1.000, 0.353, 0.322, 1.0}, "(!)");
+    if (ImGui::BeginItemTooltip()) {
+        for (auto& session : sessions) {
+            auto* other = hook::agent::Find(session->agent, variable.name);
+            if (other) {
+                uint64_t other_bits = hook::agent::Load(*other);
+                char text[64];
+                FormatAgentValue(text, sizeof(text), other->type, other_bits);
+                ImGui::Text("%llu: %s", (unsigned long long)session->pid, text);
+            } else {
+                ImGui::Text("%llu: <missing>", (unsigned long long)session->pid);
+            }
+        }
+        ImGui::EndTooltip();
+    }
+}
+
+}
+
+// Agent variables are read straight from shared memory every frame and
+// written back on change, without stopping the target.
+void DisplayAgentVariable(const hook::agent::Variable& variable) {
+    ImGui::Text("%s =", variable.name);
+    ImGui::SameLine();
+
+    ImGui::PushID(variable.name);
+    uint64_t bits = hook::agent::Load(variable);
+    bool changed = false;
+    if (variable.type == hook::agent::Type::Bool) {
+        bool value = bits != 0;
+        changed = ImGui::Checkbox("##agent", &value);
+        bits = value;
+    } else {
+        // Only commit on Enter, so typing 250 doesn't publish 2 and 25 first.
+        changed = ImGui::InputScalar("##agent", ToImGuiDataType(variable.type), &bits, nullptr, nullptr, nullptr, ImGuiInputTextFlags_EnterReturnsTrue);
+    }
+    ImGui::PopID();
+    if (changed) {
+        PublishAgentChange(variable, bits);
+    }
+    DisplayAgentDivergence(variable, bits);
+}
+
+// Widgets are identified by their position in the tree rather than by
+// labels built from names, so drawing a stable tree allocates nothing.
+void DisplayVariable(VariableInfo& varInfo) {
+    if (varInfo.IsPlaceholder()) {
+        DisplayPlaceholder(varInfo);
+        return;
+    }
+
+    if (varInfo.IsRoot() && !varInfo.function_name.empty()) {
+        ImGui::Text("(%s) %s =", varInfo.function_name.c_str(), varInfo.name.c_str());
+    } else {
+        ImGui::Text("%s =", varInfo.name.c_str());
+    }
+    ImGui::SameLine();
+
+    if (varInfo.IsAggregateType()) {
+        if (ImGui::TreeNodeEx("##members", expand_variables ? ImGuiTreeNodeFlags_DefaultOpen : ImGuiTreeNodeFlags_None)) {
+            for (size_t i = 0; i < varInfo.children.size(); ++i) {
+                ImGui::PushID(static_cast<int>(i));
+                DisplayVariable(*varInfo.children[i]);
+                ImGui::PopID();
+            }
+            ImGui::TreePop();
+        }
+    } else {
+        if (varInfo.type_class == TypeClass::Enumeration) {
+            const auto& member_names = varInfo.enum_members;
+            int index = 0;
+            for (auto& n : member_names) {
+                if (varInfo.value == n) {
+                    if (ImGui::SliderInt("##value", &index, 0, member_names.size() - 1, member_names[index].c_str())) {
+                        varInfo.value = member_names[index];
+                    }
+                    break;
+                }
+                ++index;
+            }
+            if (ImGui::IsItemDeactivatedAfterEdit()) {
+                PublishChange(varInfo);
+            }
+        } else if (varInfo.basic_type == BasicType::Bool) {
+            bool value = varInfo.value == "true";
+            if (ImGui::Checkbox("##value", &value)) {
+                varInfo.value = value ? "true" : "false";
+            }
+            if (ImGui::IsItemDeactivatedAfterEdit()) {
+                PublishChange(varInfo);
+            }
+        } else if (varInfo.basic_type == BasicType::UnsignedChar) {
+            uint8_t value = std::strtoul(varInfo.value.c_str(), nullptr, 10);
+            static auto min = std::numeric_limits<uint8_t>::min();
+            static auto max = std::numeric_limits<uint8_t>::max();
+            if (ImGui::SliderScalar("##value", ImGuiDataType_U8, &value, &min , &max)) {
+                StoreNumber(varInfo, value);
+            }
+            if (ImGui::IsItemDeactivatedAfterEdit()) {
+                PublishChange(varInfo);
+            }
+            ImGui::SameLine(); HelpMarker("CTRL+click to input value");
+        } else if (varInfo.basic_type == BasicType::Int) {
+            int value = std::strtol(varInfo.value.c_str(), nullptr, 10);
+            static auto min = std::numeric_limits<int>::min() / 2;
+            static auto max = std::numeric_limits<int>::max() / 2;
+            if (ImGui::SliderScalar("##value", ImGuiDataType_S32, &value, &min , &max)) {
+                StoreNumber(varInfo, value);
+            }
+            if (ImGui::IsItemDeactivatedAfterEdit()) {
+                PublishChange(varInfo);
+            }
+            ImGui::SameLine(); HelpMarker("CTRL+click to input value");
+        } else {
+            ImGui::InputText("##value", &varInfo.value, ImGuiInputTextFlags_CharsDecimal);
+            if (ImGui::IsItemDeactivatedAfterEdit()) {
+                PublishChange(varInfo);
+            }
+        }
+        DisplayDivergence(varInfo);
+    }
+}
+
+void DisplaySessions() {
+    SessionsLock lock;
+    if (sessions.empty()) return;
+
+    if (sessions.size() > 1) {
+        ImGui::TextDisabled("%zu processes, showing pid %llu", sessions.size(), (unsigned long long)sessions.front()->pid);
+    }
+
+    const hook::agent::Segment* agent = sessions.front()->agent;
+    if (uint32_t count = hook::agent::Count(agent); count > 0) {
+        ImGui::SeparatorText("Agent");
+        for (uint32_t i = 0; i < count; ++i) {
+            DisplayAgentVariable(agent->variables[i]);
+        }
+        ImGui::SeparatorText("Variables");
+    }
+    // Roots are identified by function and name so their trees stay open
+    // when variables come and go around them.
+    for (auto& var : sessions.front()->variables) {
+        if (var.IsRoot()) {
+            ImGui::PushID(var.function_name.c_str());
+            ImGui::PushID(var.name.c_str());
+            DisplayVariable(var);
+            ImGui::PopID();
+            ImGui::PopID();
+        }
+    }
+}
+
+}
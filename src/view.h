@@ -0,0 +1,20 @@
+#pragma once
+
+#include "hook_agent.h"
+#include "variables.h"
+
+namespace Hook {
+
+// Opens every aggregate by default instead of leaving it collapsed.
+extern bool expand_variables;
+
+void HelpMarker(const char* desc);
+
+void DisplayAgentVariable(const hook::agent::Variable& variable);
+void DisplayVariable(VariableInfo& varInfo);
+
+// Shows the first session's variables, flagging values that differ in any
+// other session.
+void DisplaySessions();
+
+}
@@ -1,3 +1,5 @@
+#include "hook_agent.h"
+
 #ifdef HOOK
 #define const volatile
 #endif
\ No newline at end of file
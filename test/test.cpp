@@ -6,6 +6,7 @@
 using namespace std::chrono_literals;
 
 float global_float = 3.14f;
+HOOK_VARIABLE(int, tuning_batch_size, 16);
 
 struct Foo {
     int a = 0;
@@ -46,6 +47,7 @@ int main() {
         std::cout << foo << std::endl;
         std::cout << bar << std::endl;
         std::cout << "global_float: " << global_float << std::endl;
+        std::cout << "tuning_batch_size: " << tuning_batch_size << std::endl;
     }
 
     std::cout << "exited!" << std::endl;
@@ -1,2 +1,2 @@
-g++ -std=c++20 -g -O0 -DHOOK -o test test.cpp
+g++ -std=c++20 -g -O0 -DHOOK -I../src -o test test.cpp
 ./test &
\ No newline at end of file